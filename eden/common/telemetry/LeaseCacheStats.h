@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include <fb303/ServiceData.h>
+
+#include "eden/common/telemetry/StatsGroup.h"
+#include "eden/common/utils/LeaseCache.h"
+
+namespace facebook::eden {
+
+struct LeaseCacheStats : StatsGroup<LeaseCacheStats> {
+  Counter hit{"lease_cache.hit"};
+  Counter miss{"lease_cache.miss"};
+  Counter eviction{"lease_cache.eviction"};
+  Counter evictedWeight{"lease_cache.evicted_weight"};
+};
+
+/**
+ * Records the events of a LeaseCache in LeaseCacheStats. The hit rate is
+ * hit / (hit + miss).
+ *
+ * The current weight of the cache is a gauge rather than a windowed
+ * statistic, so it is exported as the fb303 dynamic counter weightCounter
+ * for as long as the observer lives. Caches observed at the same time need
+ * distinct counter names.
+ */
+template <typename StatsPtr>
+class LeaseCacheStatsObserver : public LeaseCacheObserver {
+ public:
+  explicit LeaseCacheStatsObserver(
+      StatsPtr stats,
+      std::string weightCounter = "lease_cache.weight")
+      : stats_{std::move(stats)}, weightCounter_{std::move(weightCounter)} {
+    fb303::fbData->getDynamicCounters()->registerCallback(
+        weightCounter_, [this] { return weight(); });
+  }
+
+  ~LeaseCacheStatsObserver() override {
+    fb303::fbData->getDynamicCounters()->unregisterCallback(weightCounter_);
+  }
+
+  LeaseCacheStatsObserver(const LeaseCacheStatsObserver&) = delete;
+  LeaseCacheStatsObserver& operator=(const LeaseCacheStatsObserver&) = delete;
+
+  void hit() override {
+    stats_->increment(&LeaseCacheStats::hit, 1);
+  }
+
+  void miss() override {
+    stats_->increment(&LeaseCacheStats::miss, 1);
+  }
+
+  void evicted(size_t weight) override {
+    stats_->increment(&LeaseCacheStats::eviction, 1);
+    if (weight != 0) {
+      stats_->increment(&LeaseCacheStats::evictedWeight, weight);
+    }
+  }
+
+  void weightChanged(int64_t delta) override {
+    weight_.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  /**
+   * The current weight of the observed cache.
+   */
+  int64_t weight() const {
+    return weight_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  StatsPtr stats_;
+  const std::string weightCounter_;
+  std::atomic<int64_t> weight_{0};
+};
+
+} // namespace facebook::eden
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/telemetry/LeaseCacheStats.h"
+
+#include <fb303/ServiceData.h>
+#include <folly/portability/GTest.h>
+#include <memory>
+
+using namespace facebook::eden;
+
+namespace {
+
+/**
+ * Stands in for the thread-local stats of a process, summing each counter.
+ */
+struct RecordingStats {
+  void increment(LeaseCacheStats::CounterPtr counter, int64_t value) {
+    if (counter == &LeaseCacheStats::hit) {
+      hits += value;
+    } else if (counter == &LeaseCacheStats::miss) {
+      misses += value;
+    } else if (counter == &LeaseCacheStats::eviction) {
+      evictions += value;
+    } else if (counter == &LeaseCacheStats::evictedWeight) {
+      evictedWeight += value;
+    }
+  }
+
+  int64_t hits{0};
+  int64_t misses{0};
+  int64_t evictions{0};
+  int64_t evictedWeight{0};
+};
+
+using Observer = LeaseCacheStatsObserver<RecordingStats*>;
+
+constexpr auto kWeightCounter = "lease_cache_stats_test.weight";
+
+} // namespace
+
+TEST(LeaseCacheStats, observerRecordsCacheEvents) {
+  RecordingStats stats;
+  auto observer = std::make_shared<Observer>(&stats, kWeightCounter);
+
+  LeaseCache<int, int>::Options options;
+  options.maxSize = 2;
+  options.numShards = 1;
+  options.weigher = [](const int&, const int& value) {
+    return static_cast<size_t>(value);
+  };
+  options.observer = observer;
+  {
+    LeaseCache<int, int> cache{options, [](const int& key) {
+      return folly::makeFuture(std::make_shared<int>(key * 10));
+    }};
+    auto weight = [&] { return static_cast<int64_t>(cache.weight()); };
+
+    EXPECT_EQ(10, *cache.get(1).get());
+    EXPECT_EQ(10, *cache.get(1).get());
+    EXPECT_EQ(20, *cache.get(2).get());
+    EXPECT_EQ(30, *cache.get(3).get());
+
+    EXPECT_EQ(1, stats.hits);
+    EXPECT_EQ(3, stats.misses);
+    EXPECT_EQ(1, stats.evictions);
+    EXPECT_EQ(60 - weight(), stats.evictedWeight);
+
+    // The weight is the current one, not a sum of recent changes.
+    EXPECT_EQ(weight(), observer->weight());
+    EXPECT_EQ(weight(), fb303::fbData->getCounter(kWeightCounter));
+    cache.erase(3);
+    EXPECT_EQ(weight(), observer->weight());
+    EXPECT_EQ(weight(), fb303::fbData->getCounter(kWeightCounter));
+  }
+
+  observer.reset();
+  EXPECT_FALSE(fb303::fbData->getCounterIfExists(kWeightCounter));
+}
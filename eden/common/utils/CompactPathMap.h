@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/FBVector.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "eden/common/utils/CaseSensitivity.h"
+#include "eden/common/utils/PathFuncs.h"
+#include "eden/common/utils/PathMap.h"
+#include "eden/common/utils/Throw.h"
+
+namespace facebook::eden {
+
+/**
+ * A read-only, memory-compact PathMap from PathComponent to Value.
+ *
+ * PathMap stores a vector of std::pair<PathComponent, Value>, so every name
+ * that doesn't fit in the string's inline storage is its own heap allocation
+ * and a binary search touches one of them per probe. CompactPathMap instead
+ * stores the sorted names back to back in a single buffer, with a parallel
+ * array of offsets into it and a parallel array of values.
+ *
+ * With KeyEncoding::FrontCoded, each name of at most kMaxDecodedName bytes,
+ * except every kRestartInterval-th one, only stores the bytes that differ
+ * from the previous name; sorted siblings ("foo_test.cpp", "foo_test.h", ...)
+ * often share long prefixes. Lookups binary search the fully stored restart
+ * names and then decode at most kRestartInterval names sequentially.
+ * Iterating decodes each name incrementally into a fixed buffer inside the
+ * iterator, so the key of a front-coded iterator is only valid until that
+ * iterator is advanced or destroyed. Neither allocates.
+ *
+ * Lookups take the same Piece-based arguments as PathMap, and ordering and
+ * case sensitivity match the PathMap it was built from.
+ */
+template <typename Value>
+class CompactPathMap {
+ public:
+  enum class KeyEncoding : uint8_t {
+    Plain,
+    FrontCoded,
+  };
+
+  using key_type = PathComponent;
+  using mapped_type = Value;
+  using size_type = size_t;
+  using Vector = folly::fbvector<std::pair<PathComponent, Value>>;
+
+  static constexpr size_t kRestartInterval = 16;
+  static constexpr size_t kMaxDecodedName = std::numeric_limits<uint8_t>::max();
+
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<PathComponentPiece, const Value&>;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+
+    struct pointer {
+      const value_type* operator->() const {
+        return &pair;
+      }
+      value_type pair;
+    };
+
+    const_iterator() = default;
+
+    PathComponentPiece key() const {
+      return PathComponentPiece{name(), detail::SkipPathSanityCheck{}};
+    }
+
+    const Value& value() const {
+      return map_->values_[index_];
+    }
+
+    reference operator*() const {
+      return reference{key(), value()};
+    }
+
+    pointer operator->() const {
+      return pointer{**this};
+    }
+
+    const_iterator& operator++() {
+      if (map_->encoding_ == KeyEncoding::Plain) {
+        ++index_;
+        return *this;
+      }
+
+      auto previous = name();
+      ++index_;
+      if (index_ == map_->size() || map_->shared_[index_] == 0) {
+        return *this;
+      }
+      // Names stored whole are viewed in place, so the previous name is only
+      // in decoded_ if it shares a prefix too, and then that prefix is
+      // already where it belongs.
+      size_t shared = map_->shared_[index_];
+      if (previous.data() != decoded_.data()) {
+        std::copy_n(previous.data(), shared, decoded_.data());
+      }
+      auto suffix = map_->storedName(index_);
+      std::copy(suffix.begin(), suffix.end(), decoded_.data() + shared);
+      decodedSize_ = static_cast<uint8_t>(shared + suffix.size());
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    friend bool operator==(const const_iterator& a, const const_iterator& b) {
+      return a.index_ == b.index_;
+    }
+
+    friend bool operator!=(const const_iterator& a, const const_iterator& b) {
+      return a.index_ != b.index_;
+    }
+
+   private:
+    const_iterator(const CompactPathMap* map, size_t index)
+        : map_{map}, index_{index} {}
+
+    std::string_view name() const {
+      if (map_->encoding_ == KeyEncoding::FrontCoded &&
+          map_->shared_[index_] != 0) {
+        return std::string_view{decoded_.data(), decodedSize_};
+      }
+      return map_->storedName(index_);
+    }
+
+    const CompactPathMap* map_{nullptr};
+    size_t index_{0};
+    // The current name, for KeyEncoding::FrontCoded entries that share a
+    // prefix with the previous one. Such names fit by construction.
+    uint8_t decodedSize_{0};
+    std::array<char, kMaxDecodedName> decoded_;
+
+    friend class CompactPathMap;
+  };
+
+  using iterator = const_iterator;
+
+  /**
+   * Build from an unsorted vector of entries. Entries are sorted and
+   * deduplicated exactly as PathMap(Vector&&, CaseSensitivity) does: the
+   * earliest of several equal keys wins.
+   */
+  CompactPathMap(
+      Vector&& entries,
+      CaseSensitivity caseSensitive,
+      KeyEncoding encoding = KeyEncoding::Plain)
+      : CompactPathMap{
+            PathMap<Value>{std::move(entries), caseSensitive},
+            encoding} {}
+
+  /**
+   * Build from the contents of a PathMap, moving its values.
+   */
+  explicit CompactPathMap(
+      PathMap<Value>&& map,
+      KeyEncoding encoding = KeyEncoding::Plain)
+      : caseSensitive_{map.getCaseSensitivity()}, encoding_{encoding} {
+    offsets_.reserve(map.size() + 1);
+    values_.reserve(map.size());
+    if (encoding_ == KeyEncoding::FrontCoded) {
+      shared_.reserve(map.size());
+    }
+
+    std::string_view previous;
+    size_t index = 0;
+    for (auto& [name, value] : map) {
+      auto view = name.view();
+      offsets_.push_back(checkedOffset(names_.size()));
+      if (encoding_ == KeyEncoding::FrontCoded) {
+        size_t shared = 0;
+        if (index % kRestartInterval != 0 && view.size() <= kMaxDecodedName) {
+          auto limit = std::min<size_t>(
+              {view.size(),
+               previous.size(),
+               std::numeric_limits<uint8_t>::max()});
+          while (shared < limit && view[shared] == previous[shared]) {
+            ++shared;
+          }
+        }
+        shared_.push_back(static_cast<uint8_t>(shared));
+        names_.append(view.substr(shared));
+      } else {
+        names_.append(view);
+      }
+      values_.push_back(std::move(value));
+      previous = view;
+      ++index;
+    }
+    offsets_.push_back(checkedOffset(names_.size()));
+    names_.shrink_to_fit();
+  }
+
+  const_iterator begin() const {
+    return const_iterator{this, 0};
+  }
+
+  const_iterator end() const {
+    return const_iterator{this, size()};
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+
+  size_type size() const {
+    return values_.size();
+  }
+
+  bool empty() const {
+    return values_.empty();
+  }
+
+  /** Find using the Piece representation of a key.
+   * Allocates neither a copy of the key string nor a decoded name.
+   */
+  const_iterator find(PathComponentPiece key) const {
+    if (encoding_ == KeyEncoding::Plain) {
+      return findPlain(key);
+    }
+    return findFrontCoded(key);
+  }
+
+  /** Returns a reference to the value for key, if present.
+   * Throws std::out_of_range if the key is not present. */
+  const mapped_type& at(PathComponentPiece key) const {
+    auto iter = find(key);
+    if (iter == end()) {
+      throwf<std::out_of_range>("no such key {}", key);
+    }
+    return iter.value();
+  }
+
+  const mapped_type& operator[](PathComponentPiece key) const {
+    return at(key);
+  }
+
+  /** Returns 1 if there is an entry with the given key and 0 otherwise. */
+  size_type count(PathComponentPiece key) const {
+    return find(key) != end();
+  }
+
+  CaseSensitivity getCaseSensitivity() const {
+    return caseSensitive_;
+  }
+
+  KeyEncoding getKeyEncoding() const {
+    return encoding_;
+  }
+
+  /**
+   * Number of bytes used to store the names, excluding the offset table.
+   */
+  size_t getNameBytes() const {
+    return names_.size();
+  }
+
+  friend bool operator==(const CompactPathMap& lhs, const CompactPathMap& rhs) {
+    return lhs.size() == rhs.size() &&
+        std::equal(
+               lhs.begin(),
+               lhs.end(),
+               rhs.begin(),
+               [](const auto& a, const auto& b) {
+                 return a.first == b.first && a.second == b.second;
+               });
+  }
+
+  friend bool operator!=(const CompactPathMap& lhs, const CompactPathMap& rhs) {
+    return !(lhs == rhs);
+  }
+
+ private:
+  static uint32_t checkedOffset(size_t offset) {
+    if (offset > std::numeric_limits<uint32_t>::max()) {
+      throwf<std::length_error>(
+          "CompactPathMap names exceed {} bytes",
+          std::numeric_limits<uint32_t>::max());
+    }
+    return static_cast<uint32_t>(offset);
+  }
+
+  // The bytes stored for entry `index`: the whole name for Plain encoding and
+  // for restart entries, otherwise the suffix after the shared prefix.
+  std::string_view storedName(size_t index) const {
+    return std::string_view{names_}.substr(
+        offsets_[index], offsets_[index + 1] - offsets_[index]);
+  }
+
+  PathComponentPiece piece(std::string_view name) const {
+    return PathComponentPiece{name, detail::SkipPathSanityCheck{}};
+  }
+
+  const_iterator findPlain(PathComponentPiece key) const {
+    size_t lo = 0;
+    size_t hi = size();
+    while (lo < hi) {
+      auto mid = lo + (hi - lo) / 2;
+      if (isPathPieceLess(piece(storedName(mid)), key, caseSensitive_)) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo != size() &&
+        isPathPieceEqual(piece(storedName(lo)), key, caseSensitive_)) {
+      return const_iterator{this, lo};
+    }
+    return end();
+  }
+
+  const_iterator findFrontCoded(PathComponentPiece key) const {
+    // Find the last restart entry that is not after key.
+    size_t blocks = (size() + kRestartInterval - 1) / kRestartInterval;
+    size_t lo = 0;
+    size_t hi = blocks;
+    while (lo < hi) {
+      auto mid = lo + (hi - lo) / 2;
+      if (isPathPieceLess(
+              key, piece(storedName(mid * kRestartInterval)), caseSensitive_)) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    if (lo == 0) {
+      return end();
+    }
+
+    // Decode the block in the iterator that will be returned.
+    const_iterator it{this, (lo - 1) * kRestartInterval};
+    auto last = std::min(it.index_ + kRestartInterval, size());
+    while (true) {
+      auto name = it.key();
+      if (isPathPieceEqual(name, key, caseSensitive_)) {
+        return it;
+      }
+      if (isPathPieceLess(key, name, caseSensitive_) ||
+          it.index_ + 1 == last) {
+        return end();
+      }
+      ++it;
+    }
+  }
+
+  CaseSensitivity caseSensitive_;
+  KeyEncoding encoding_;
+  std::string names_;
+  // offsets_[i] is where entry i's stored bytes start in names_; there is one
+  // extra trailing offset for the end of the last entry.
+  folly::fbvector<uint32_t> offsets_;
+  // For KeyEncoding::FrontCoded, the number of leading bytes each entry
+  // shares with the previous one.
+  folly::fbvector<uint8_t> shared_;
+  folly::fbvector<Value> values_;
+};
+
+} // namespace facebook::eden
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <eden/common/utils/MappedDiskStorage.h>
+#include <eden/common/utils/MappedDiskVector.h>
+#include <folly/Range.h>
+#include <folly/ScopeGuard.h>
+#include <folly/logging/xlog.h>
+
+namespace facebook::eden {
+
+/**
+ * A MappedDiskVector that can be read from any number of threads, without
+ * locks, while a single thread appends to it.
+ *
+ * MappedDiskVector remaps its file as it grows, and the mapping may move,
+ * which would leave concurrent readers with dangling pointers. Instead,
+ * ConcurrentMappedDiskVector maps maxSizeInBytes of address space up front.
+ * The file still starts small and is extended with ftruncate() as records
+ * are appended, but the mapping already covers the new pages, so it never
+ * moves and a pointer to a record stays valid for the lifetime of the
+ * vector. Reserving address space costs no memory: only the pages backed by
+ * the file are ever touched.
+ *
+ * Appended records are published by a release store of the size once they
+ * are fully constructed. A reader that observes size() == n may read
+ * records [0, n). Records cannot be modified or removed once published.
+ *
+ * Only one thread at a time may call the mutating methods - emplace_back(),
+ * append(), reserve(), setDurability() and flush(). Callers with several
+ * writers must serialize them.
+ */
+template <typename T>
+class ConcurrentMappedDiskVector {
+ public:
+  /**
+   * Address space reserved by default: 64 GiB on 64-bit platforms, where it
+   * is plentiful, and 1 GiB elsewhere.
+   */
+  static constexpr size_t kDefaultMaxSizeInBytes =
+      sizeof(void*) >= 8 ? size_t{1} << 36 : size_t{1} << 30;
+
+  /**
+   * Opens or creates the vector at the specified path, migrating it from
+   * OldVersions as MappedDiskVector<T>::open() does.
+   *
+   * Throws std::length_error once appending would grow the file past
+   * maxSizeInBytes.
+   */
+  template <typename... OldVersions>
+  static ConcurrentMappedDiskVector open(
+      folly::StringPiece path,
+      size_t maxSizeInBytes = kDefaultMaxSizeInBytes,
+      const MappedDiskOptions& options = {}) {
+    return ConcurrentMappedDiskVector{
+        MappedDiskVector<T>::template open<OldVersions...>(path, options),
+        maxSizeInBytes};
+  }
+
+  /**
+   * Creates a new vector at the specified path, overwriting any that was
+   * there prior.
+   */
+  static ConcurrentMappedDiskVector createOrOverwrite(
+      folly::StringPiece path,
+      size_t maxSizeInBytes = kDefaultMaxSizeInBytes,
+      const MappedDiskOptions& options = {}) {
+    return ConcurrentMappedDiskVector{
+        MappedDiskVector<T>::createOrOverwrite(path, options), maxSizeInBytes};
+  }
+
+  /**
+   * Take over the file of vector, reserving address space for it to grow to
+   * maxSizeInBytes, or its current size if that is larger.
+   */
+  ConcurrentMappedDiskVector(MappedDiskVector<T> vector, size_t maxSizeInBytes)
+      : storage_{std::move(vector).release()} {
+    storage_.reserveAddressSpace(
+        std::max(maxSizeInBytes, storage_.sizeInBytes()));
+    begin_ = static_cast<T*>(storage_.records());
+    maxCapacity_ = (storage_.reservedSizeInBytes() -
+                    sizeof(MappedDiskStorage::Header)) /
+        sizeof(T);
+    size_.store(storage_.entryCount(), std::memory_order_relaxed);
+  }
+
+  // Readers hold pointers to this object and into its mapping.
+  ConcurrentMappedDiskVector(const ConcurrentMappedDiskVector&) = delete;
+  ConcurrentMappedDiskVector& operator=(const ConcurrentMappedDiskVector&) =
+      delete;
+
+  /**
+   * The number of published records. Safe to call from any thread.
+   */
+  size_t size() const {
+    return size_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Safe to call from any thread, for any index below a value previously
+   * returned by size().
+   */
+  const T& operator[](size_t index) const {
+    return begin_[index];
+  }
+
+  /**
+   * The published records, as of the call. Safe to call from any thread.
+   */
+  folly::Range<const T*> snapshot() const {
+    return folly::Range<const T*>{begin_, size()};
+  }
+
+  /**
+   * The most records the vector will ever hold.
+   */
+  size_t maxCapacity() const {
+    return maxCapacity_;
+  }
+
+  /**
+   * The number of records that fit in the file as it is now. Only the writer
+   * may call this.
+   */
+  size_t capacity() const {
+    return storage_.recordCapacityInBytes() / sizeof(T);
+  }
+
+  /**
+   * Make room for at least n records. Only the writer may call this.
+   */
+  void reserve(size_t n) {
+    if (n > capacity()) {
+      growTo(n, /*exact=*/true);
+    }
+  }
+
+  template <typename... Args>
+  void emplace_back(Args&&... args) {
+    size_t oldSize = size_.load(std::memory_order_relaxed);
+    if (oldSize == capacity()) {
+      growTo(oldSize + 1, /*exact=*/false);
+    }
+
+    new (begin_ + oldSize) T{std::forward<Args>(args)...}; // may throw
+    publish(oldSize, oldSize + 1);
+  }
+
+  /**
+   * Append every element of range, each of which is used to construct a T.
+   *
+   * The records become visible to readers all at once, after the last one is
+   * constructed. If constructing a record throws, the records constructed
+   * before it are published.
+   */
+  template <typename Range>
+  void append(Range&& range) {
+    using std::begin;
+    using std::end;
+    auto first = begin(range);
+    auto last = end(range);
+    using Iterator = decltype(first);
+    constexpr bool kIsSized = std::is_base_of_v<
+        std::forward_iterator_tag,
+        typename std::iterator_traits<Iterator>::iterator_category>;
+
+    size_t oldSize = size_.load(std::memory_order_relaxed);
+    if constexpr (kIsSized) {
+      size_t count = std::distance(first, last);
+      if (count > capacity() - oldSize) {
+        growTo(checkedAdd(oldSize, count), /*exact=*/false);
+      }
+    }
+
+    size_t newSize = oldSize;
+    SCOPE_EXIT {
+      publish(oldSize, newSize);
+    };
+    for (; first != last; ++first) {
+      if constexpr (!kIsSized) {
+        if (newSize == capacity()) {
+          growTo(newSize + 1, /*exact=*/false);
+        }
+      }
+      new (begin_ + newSize) T{*first}; // may throw
+      ++newSize;
+    }
+  }
+
+  MappedDiskDurability durability() const {
+    return storage_.durability();
+  }
+
+  /**
+   * See MappedDiskDurability. The default is None. Only the writer may call
+   * this.
+   */
+  void setDurability(MappedDiskDurability durability) {
+    storage_.setDurability(durability);
+  }
+
+  /**
+   * See MappedDiskVector::flush(). Only the writer may call this.
+   */
+  void flush() {
+    storage_.flush();
+  }
+
+  /**
+   * See MappedDiskStorage::setAccessPattern(). Only the writer may call this.
+   */
+  void setAccessPattern(MappedDiskAccessPattern accessPattern) {
+    storage_.setAccessPattern(accessPattern);
+  }
+
+ private:
+  size_t checkedAdd(size_t size, size_t count) const {
+    if (count > maxCapacity_ - std::min(size, maxCapacity_)) {
+      throw std::length_error(
+          "ConcurrentMappedDiskVector exceeded its reserved address space");
+    }
+    return size + count;
+  }
+
+  /**
+   * Extend the file to fit n records, within the reserved address space.
+   */
+  void growTo(size_t n, bool exact) {
+    if (n > maxCapacity_) {
+      throw std::length_error(
+          "ConcurrentMappedDiskVector exceeded its reserved address space");
+    }
+    size_t sizeInBytes = sizeof(MappedDiskStorage::Header) + n * sizeof(T);
+    if (exact) {
+      storage_.resize(detail::roundUpToNonzeroPageSize(sizeInBytes));
+    } else {
+      storage_.grow(sizeInBytes);
+    }
+    // Readers rely on this: the file must only ever grow into the
+    // reservation.
+    XCHECK_EQ(static_cast<void*>(begin_), storage_.records());
+  }
+
+  /**
+   * Make the records [oldSize, newSize) visible to readers.
+   */
+  void publish(size_t oldSize, size_t newSize) {
+    if (newSize == oldSize) {
+      return;
+    }
+    storage_.markDirty(
+        sizeof(MappedDiskStorage::Header) + oldSize * sizeof(T),
+        (newSize - oldSize) * sizeof(T));
+    size_.store(newSize, std::memory_order_release);
+    storage_.setEntryCount(newSize);
+  }
+
+  T* begin_{nullptr};
+  size_t maxCapacity_{0};
+  std::atomic<size_t> size_{0};
+
+  MappedDiskStorage storage_;
+};
+
+} // namespace facebook::eden
@@ -45,6 +45,16 @@ class CoverageSet {
    */
   size_t getIntervalCount() const noexcept;
 
+  /**
+   * Calls fn(begin, end) for each covered interval, in increasing order.
+   */
+  template <typename Fn>
+  void forEachInterval(Fn&& fn) const {
+    for (const auto& interval : set_) {
+      fn(interval.begin, interval.end);
+    }
+  }
+
  private:
   struct Interval {
     size_t begin;
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/CpuId.h>
+#include <folly/Portability.h>
+
+/**
+ * Compiles a function for an instruction set extension that the binary as a
+ * whole does not assume, so that it can use the matching intrinsics, e.g.
+ * EDEN_TARGET_ATTRIBUTE("avx2"). Such a function must only be called after
+ * checking the corresponding flag below.
+ */
+#if FOLLY_X64 && (defined(__GNUC__) || defined(__clang__))
+#define EDEN_TARGET_ATTRIBUTE(isa) __attribute__((target(isa)))
+#else
+#define EDEN_TARGET_ATTRIBUTE(isa)
+#endif
+
+namespace facebook::eden::detail {
+
+/**
+ * Instruction set extensions supported by the running CPU.
+ *
+ * These are computed during static initialization, and code running in other
+ * static initializers may observe them as false. They must therefore only be
+ * used to pick between implementations that are all correct.
+ */
+inline const bool kCpuHasSsse3 = folly::CpuId().ssse3();
+inline const bool kCpuHasAvx2 = folly::CpuId().avx2();
+
+} // namespace facebook::eden::detail
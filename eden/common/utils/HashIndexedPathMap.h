@@ -0,0 +1,430 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/container/F14Set.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+#include "eden/common/utils/CaseSensitivity.h"
+#include "eden/common/utils/PathFuncs.h"
+#include "eden/common/utils/PathMap.h"
+#include "eden/common/utils/Throw.h"
+
+namespace facebook::eden {
+
+namespace detail {
+
+/**
+ * Hash a path piece such that two pieces that are isPathPieceEqual under
+ * `caseSensitive` hash to the same value. For CaseSensitivity::Sensitive this
+ * is the regular hash_value of the piece.
+ */
+template <typename Piece>
+uint64_t hashPathPiece(const Piece& piece, CaseSensitivity caseSensitive) {
+  if (caseSensitive == CaseSensitivity::Sensitive) {
+    return hash_value(piece);
+  }
+
+  folly::hash::SpookyHashV2 hash;
+  hash.Init(0, 0);
+  auto update = [&](std::string_view s) {
+    char folded[64];
+    while (!s.empty()) {
+      auto n = std::min(s.size(), sizeof(folded));
+      std::transform(
+          s.begin(),
+          s.begin() + n,
+          folded,
+          AsciiLessThanCaseInsensitive::toLower);
+      hash.Update(folded, n);
+      s.remove_prefix(n);
+    }
+  };
+  if constexpr (std::is_same_v<Piece, PathComponentPiece>) {
+    update(piece.view());
+  } else if (folly::kIsWindows) {
+    // Composed paths compare component-wise on Windows, so either separator
+    // must hash the same.
+    for (auto component : piece.components()) {
+      update(component.view());
+    }
+  } else {
+    update(piece.view());
+  }
+
+  uint64_t hash1, hash2;
+  hash.Final(&hash1, &hash2);
+  return hash1;
+}
+
+} // namespace detail
+
+/**
+ * A PathMap with an additional hash index for large maps.
+ *
+ * Entries are kept in a sorted vector exactly like PathMap, so iteration is
+ * ordered and the Vector&& constructor's dedupe rule (earliest entry wins) is
+ * unchanged. Once the map holds indexThreshold entries, a side table mapping
+ * the hash of each key (case-folded for CaseSensitivity::Insensitive maps) to
+ * its position is built, and from then on find(), count(), at() and the
+ * duplicate check in insert() are O(1) instead of a binary search of string
+ * compares.
+ *
+ * Inserting or erasing a key still shifts the vector, and additionally
+ * renumbers the positions of the index entries that follow it. Both are
+ * linear scans without any string comparisons. If bulk insert performance is
+ * critical, it is better to pre-sort the data and use the Vector&&
+ * constructor.
+ *
+ * The index is only built or updated by non-const methods, so concurrent
+ * const access is as safe as it is for PathMap. Keys must not be modified
+ * through iterators.
+ */
+template <typename Value, typename Key = PathComponent>
+class HashIndexedPathMap {
+  using Map = PathMap<Value, Key>;
+  using Pair = std::pair<Key, Value>;
+  using Vector = folly::fbvector<Pair>;
+  using Piece = typename Key::piece_type;
+
+  // An index entry. The hash and position identify a key; the position is
+  // mutable so that it can be renumbered in place when the vector shifts,
+  // which doesn't change the key it refers to.
+  struct Slot {
+    uint64_t hash;
+    mutable size_t pos;
+  };
+
+  // Heterogeneous lookup key: finds the Slot of an equal key in `map`.
+  struct Lookup {
+    Piece key;
+    uint64_t hash;
+    const Map* map;
+  };
+
+  struct SlotHash {
+    using is_transparent = void;
+    using folly_is_avalanching = std::true_type;
+
+    size_t operator()(const Slot& slot) const {
+      return slot.hash;
+    }
+    size_t operator()(const Lookup& lookup) const {
+      return lookup.hash;
+    }
+  };
+
+  struct SlotEqual {
+    using is_transparent = void;
+
+    // Positions are unique, so two slots are the same key iff they have the
+    // same position.
+    bool operator()(const Slot& a, const Slot& b) const {
+      return a.pos == b.pos;
+    }
+    bool operator()(const Lookup& a, const Slot& b) const {
+      return a.hash == b.hash &&
+          isPathPieceEqual(
+                 a.key,
+                 Piece(a.map->begin()[b.pos].first),
+                 a.map->getCaseSensitivity());
+    }
+    bool operator()(const Slot& a, const Lookup& b) const {
+      return (*this)(b, a);
+    }
+  };
+
+  using Index = folly::F14FastSet<Slot, SlotHash, SlotEqual>;
+
+ public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using value_type = typename Map::value_type;
+  using iterator = typename Map::iterator;
+  using const_iterator = typename Map::const_iterator;
+  using size_type = typename Map::size_type;
+
+  static constexpr size_t kDefaultIndexThreshold = 128;
+
+  // Construct empty.
+  explicit HashIndexedPathMap(
+      CaseSensitivity caseSensitive,
+      size_t indexThreshold = kDefaultIndexThreshold)
+      : map_{caseSensitive},
+        indexThreshold_{std::max<size_t>(indexThreshold, 1)} {}
+
+  // Populate from an initializer_list.
+  HashIndexedPathMap(
+      std::initializer_list<value_type> init,
+      CaseSensitivity caseSensitive,
+      size_t indexThreshold = kDefaultIndexThreshold)
+      : map_{init, caseSensitive},
+        indexThreshold_{std::max<size_t>(indexThreshold, 1)} {
+    maybeBuildIndex();
+  }
+
+  // Initialize using given vector of entries, sorting and deduping if needed.
+  // See PathMap(Vector&&, CaseSensitivity).
+  HashIndexedPathMap(
+      Vector&& entries,
+      CaseSensitivity caseSensitive,
+      size_t indexThreshold = kDefaultIndexThreshold)
+      : map_{std::move(entries), caseSensitive},
+        indexThreshold_{std::max<size_t>(indexThreshold, 1)} {
+    maybeBuildIndex();
+  }
+
+  iterator begin() {
+    return map_.begin();
+  }
+  iterator end() {
+    return map_.end();
+  }
+  const_iterator begin() const {
+    return map_.begin();
+  }
+  const_iterator end() const {
+    return map_.end();
+  }
+  const_iterator cbegin() const {
+    return map_.cbegin();
+  }
+  const_iterator cend() const {
+    return map_.cend();
+  }
+
+  size_type size() const {
+    return map_.size();
+  }
+  bool empty() const {
+    return map_.empty();
+  }
+  void reserve(size_type n) {
+    map_.reserve(n);
+  }
+
+  void clear() {
+    map_.clear();
+    index_.clear();
+  }
+
+  void swap(HashIndexedPathMap& other) noexcept {
+    map_.swap(other.map_);
+    index_.swap(other.index_);
+    std::swap(indexThreshold_, other.indexThreshold_);
+  }
+
+  /** Find using the Piece representation of a key.
+   * Does not allocate a copy of the key string.
+   */
+  iterator find(Piece key) {
+    if (index_.empty()) {
+      return map_.find(key);
+    }
+    return map_.begin() + findIndexed(makeLookup(key));
+  }
+
+  /** Find using the Piece representation of a key.
+   * Does not allocate a copy of the key string.
+   */
+  const_iterator find(Piece key) const {
+    if (index_.empty()) {
+      return map_.find(key);
+    }
+    return map_.begin() + findIndexed(makeLookup(key));
+  }
+
+  /** Insert a new key-value pair.
+   * If the key already exists, it is left unaltered.
+   * Returns a pair consisting of an iterator to the position for key and
+   * a boolean that is true if an insert took place. */
+  std::pair<iterator, bool> insert(const value_type& val) {
+    return insertImpl(
+        Piece(val.first), [&] { return map_.insert(val).first; });
+  }
+
+  /** Emplace a new key-value pair by constructing it in-place.
+   * See PathMap::emplace. */
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Piece key, Args&&... args) {
+    return insertImpl(key, [&] {
+      return map_.emplace(key, std::forward<Args>(args)...).first;
+    });
+  }
+
+  /** Returns a reference to the map position for key, creating it needed.
+   */
+  mapped_type& operator[](Piece key) {
+    return emplace(key).first->second;
+  }
+
+  /** Returns a reference to the map position for key, if present.
+   * Throws std::out_of_range if the key is not present. */
+  mapped_type& at(Piece key) {
+    auto iter = find(key);
+    if (iter == end()) {
+      throwf<std::out_of_range>("no such key {}", key);
+    }
+    return iter->second;
+  }
+
+  /** Returns a reference to the map position for key, if present.
+   * Throws std::out_of_range if the key is not present. */
+  const mapped_type& at(Piece key) const {
+    auto iter = find(key);
+    if (iter == end()) {
+      throwf<std::out_of_range>("no such key {}", key);
+    }
+    return iter->second;
+  }
+
+  /** Erase the entry at iter, returning an iterator to the following entry.
+   */
+  iterator erase(iterator iter) {
+    if (!index_.empty()) {
+      auto pos = static_cast<size_t>(iter - begin());
+      index_.erase(makeLookup(Piece(iter->first)));
+      for (const auto& slot : index_) {
+        if (slot.pos > pos) {
+          --slot.pos;
+        }
+      }
+    }
+    return map_.erase(iter);
+  }
+
+  /** Erase the value associated with key.
+   * Returns the number of matching elements that were erased; this is
+   * always either 1 or 0. */
+  size_type erase(Piece key) {
+    auto iter = find(key);
+    if (iter == end()) {
+      return 0;
+    }
+    erase(iter);
+    return 1;
+  }
+
+  /** Returns 1 if there is an entry with the given key and 0 otherwise. */
+  size_type count(Piece key) const {
+    return find(key) != end();
+  }
+
+  /** See PathMap::mergeSorted. The index is rebuilt afterwards. */
+  template <typename Range>
+  size_type mergeSorted(Range&& batch) {
+    auto inserted = map_.mergeSorted(std::forward<Range>(batch));
+    if (inserted != 0) {
+      maybeBuildIndex();
+    }
+    return inserted;
+  }
+
+  /** See PathMap::eraseSorted. The index is rebuilt afterwards. */
+  template <typename Range>
+  size_type eraseSorted(const Range& keys) {
+    auto erased = map_.eraseSorted(keys);
+    if (erased != 0 && !index_.empty()) {
+      buildIndex();
+    }
+    return erased;
+  }
+
+  CaseSensitivity getCaseSensitivity() const {
+    return map_.getCaseSensitivity();
+  }
+
+  /** Whether lookups are currently served by the hash index. */
+  bool isIndexed() const {
+    return !index_.empty();
+  }
+
+  friend bool operator==(
+      const HashIndexedPathMap& lhs,
+      const HashIndexedPathMap& rhs) {
+    return lhs.map_ == rhs.map_;
+  }
+
+  friend bool operator!=(
+      const HashIndexedPathMap& lhs,
+      const HashIndexedPathMap& rhs) {
+    return lhs.map_ != rhs.map_;
+  }
+
+ private:
+  Lookup makeLookup(Piece key) const {
+    return Lookup{
+        key, detail::hashPathPiece(key, getCaseSensitivity()), &map_};
+  }
+
+  // Returns the position of the key, or size() if it is not present.
+  size_t findIndexed(const Lookup& lookup) const {
+    auto slot = index_.find(lookup);
+    return slot == index_.end() ? map_.size() : slot->pos;
+  }
+
+  template <typename InsertFn>
+  std::pair<iterator, bool> insertImpl(Piece key, InsertFn&& insertFn) {
+    if (index_.empty()) {
+      auto sizeBefore = map_.size();
+      auto iter = insertFn();
+      bool inserted = map_.size() != sizeBefore;
+      if (inserted && map_.size() >= indexThreshold_) {
+        auto pos = iter - map_.begin();
+        buildIndex();
+        iter = map_.begin() + pos;
+      }
+      return std::make_pair(iter, inserted);
+    }
+
+    auto lookup = makeLookup(key);
+    auto existing = findIndexed(lookup);
+    if (existing != map_.size()) {
+      return std::make_pair(map_.begin() + existing, false);
+    }
+
+    auto iter = insertFn();
+    auto pos = static_cast<size_t>(iter - map_.begin());
+    for (const auto& slot : index_) {
+      if (slot.pos >= pos) {
+        ++slot.pos;
+      }
+    }
+    index_.insert(Slot{lookup.hash, pos});
+    return std::make_pair(iter, true);
+  }
+
+  void maybeBuildIndex() {
+    if (map_.size() >= indexThreshold_) {
+      buildIndex();
+    }
+  }
+
+  void buildIndex() {
+    auto caseSensitive = getCaseSensitivity();
+    index_.clear();
+    index_.reserve(map_.size());
+    size_t pos = 0;
+    for (const auto& entry : map_) {
+      index_.insert(
+          Slot{detail::hashPathPiece(Piece(entry.first), caseSensitive), pos});
+      ++pos;
+    }
+  }
+
+  Map map_;
+  Index index_;
+  size_t indexThreshold_;
+};
+
+} // namespace facebook::eden
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <fmt/format.h>
+#include <folly/container/HeterogeneousAccess.h>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "eden/common/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+/**
+ * A RelativePath or AbsolutePath along with its hash.
+ *
+ * Hashing a path walks the whole string, and a long path used as the key of
+ * several large hash maps gets hashed over and over. HashedPath computes the
+ * hash once, when it is constructed, and carries it through copies and moves.
+ *
+ * The cached hash is the one std::hash computes for the path's Piece type, so
+ * hash maps keyed by HashedPath can be queried with a plain Piece without
+ * constructing a HashedPath. This is how the std::hash, HashedPathHash and
+ * folly::HeterogeneousAccessHash specializations below behave, which makes
+ * heterogeneous lookup work out of the box with folly's F14 maps.
+ *
+ * A moved-from HashedPath may only be assigned to or destroyed.
+ */
+template <typename Path>
+class HashedPath {
+ public:
+  using piece_type = typename Path::piece_type;
+  using stored_type = Path;
+
+  explicit HashedPath(Path path)
+      : path_{std::move(path)}, hash_{std::hash<piece_type>{}(path_.piece())} {}
+
+  explicit HashedPath(piece_type piece) : HashedPath{piece.copy()} {}
+
+  const Path& path() const {
+    return path_;
+  }
+
+  piece_type piece() const {
+    return path_.piece();
+  }
+
+  /* implicit */ operator piece_type() const {
+    return piece();
+  }
+
+  std::string_view view() const {
+    return path_.view();
+  }
+
+  size_t hash() const {
+    return hash_;
+  }
+
+  /**
+   * Return a copy of this path, without rehashing it.
+   */
+  HashedPath copy() const {
+    return *this;
+  }
+
+  friend bool operator==(const HashedPath& a, const HashedPath& b) {
+    return a.hash_ == b.hash_ && a.piece() == b.piece();
+  }
+
+  friend bool operator!=(const HashedPath& a, const HashedPath& b) {
+    return !(a == b);
+  }
+
+  friend bool operator==(const HashedPath& a, const piece_type& b) {
+    return a.piece() == b;
+  }
+
+  friend bool operator==(const piece_type& a, const HashedPath& b) {
+    return a == b.piece();
+  }
+
+  friend bool operator!=(const HashedPath& a, const piece_type& b) {
+    return !(a == b);
+  }
+
+  friend bool operator!=(const piece_type& a, const HashedPath& b) {
+    return !(a == b);
+  }
+
+ private:
+  Path path_;
+  size_t hash_;
+};
+
+using HashedRelativePath = HashedPath<RelativePath>;
+using HashedAbsolutePath = HashedPath<AbsolutePath>;
+
+/**
+ * Transparent hasher for HashedPath: uses the cached hash of a HashedPath and
+ * hashes a Piece the same way.
+ */
+template <typename Path>
+struct HashedPathHash {
+  using is_transparent = void;
+  using folly_is_avalanching = std::true_type;
+
+  size_t operator()(const HashedPath<Path>& path) const {
+    return path.hash();
+  }
+
+  size_t operator()(const typename Path::piece_type& piece) const {
+    return std::hash<typename Path::piece_type>{}(piece);
+  }
+};
+
+/**
+ * Transparent equality for HashedPath and its Piece type.
+ */
+template <typename Path>
+struct HashedPathEqual {
+  using is_transparent = void;
+
+  bool operator()(const HashedPath<Path>& a, const HashedPath<Path>& b) const {
+    return a == b;
+  }
+
+  bool operator()(
+      const HashedPath<Path>& a,
+      const typename Path::piece_type& b) const {
+    return a == b;
+  }
+
+  bool operator()(
+      const typename Path::piece_type& a,
+      const HashedPath<Path>& b) const {
+    return a == b;
+  }
+};
+
+} // namespace facebook::eden
+
+namespace std {
+template <typename Path>
+struct hash<facebook::eden::HashedPath<Path>> {
+  size_t operator()(const facebook::eden::HashedPath<Path>& path) const {
+    return path.hash();
+  }
+};
+} // namespace std
+
+namespace folly {
+template <typename Path>
+struct HeterogeneousAccessHash<facebook::eden::HashedPath<Path>>
+    : facebook::eden::HashedPathHash<Path> {};
+
+template <typename Path>
+struct HeterogeneousAccessEqualTo<facebook::eden::HashedPath<Path>>
+    : facebook::eden::HashedPathEqual<Path> {};
+} // namespace folly
+
+template <typename Path>
+struct fmt::formatter<facebook::eden::HashedPath<Path>>
+    : formatter<string_view> {
+  template <typename Context>
+  auto format(const facebook::eden::HashedPath<Path>& p, Context& ctx) const {
+    return formatter<string_view>::format(p.view(), ctx);
+  }
+};
@@ -315,6 +315,14 @@ folly::SemiFuture<T> ImmediateFuture<T>::semi() && {
   folly::assume_unreachable();
 }
 
+#if FOLLY_HAS_COROUTINES
+template <typename T>
+detail::ImmediateFutureAwaiter<T> ImmediateFuture<T>::operator co_await() &&
+    noexcept {
+  return detail::ImmediateFutureAwaiter<T>{std::move(*this)};
+}
+#endif
+
 template <typename T, typename E>
 typename std::
     enable_if_t<std::is_base_of<std::exception, E>::value, ImmediateFuture<T>>
@@ -17,6 +17,9 @@ class ImmediateFuture;
 
 namespace detail {
 
+template <typename T>
+class ImmediateFutureAwaiter;
+
 template <typename T>
 struct isImmediateFuture : std::false_type {};
 
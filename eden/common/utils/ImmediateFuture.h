@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <optional>
+
+#include <folly/coro/Coroutine.h>
 #include <folly/futures/Future.h>
 #include "eden/common/utils/ImmediateFuture-pre.h"
 
@@ -237,6 +240,19 @@ class ImmediateFuture {
    */
   [[nodiscard]] folly::SemiFuture<T> semi() &&;
 
+#if FOLLY_HAS_COROUTINES
+  /**
+   * Make ImmediateFuture awaitable from a coroutine. Awaiting a ready
+   * ImmediateFuture does not suspend the coroutine.
+   *
+   * An ImmediateTask that awaits a non-ready ImmediateFuture is resumed
+   * when its own result is consumed, on the consuming thread, like the
+   * callbacks passed to thenValue(). Other coroutines are resumed on the
+   * thread that completes the future.
+   */
+  detail::ImmediateFutureAwaiter<T> operator co_await() && noexcept;
+#endif
+
   /**
    * Wait for the future to complete and return its value or throw its
    * exception.
@@ -453,6 +469,62 @@ template <typename... Fs>
 ImmediateFuture<std::tuple<typename folly::remove_cvref_t<Fs>::value_type...>>
 collectAllSafe(Fs&&... fs);
 
+#if FOLLY_HAS_COROUTINES
+namespace detail {
+
+/**
+ * Base of ImmediateTask<T>::promise_type, through which ImmediateFutureAwaiter
+ * hands the future that resumes the coroutine to the ImmediateTask.
+ */
+class ImmediateTaskPromiseBase {
+ public:
+  /**
+   * Set when the coroutine suspends: completes, once consumed, after the
+   * result of the awaited future was stored in the awaiter.
+   */
+  std::optional<folly::SemiFuture<folly::Unit>> suspendedOn;
+};
+
+template <typename T>
+class ImmediateFutureAwaiter {
+ public:
+  explicit ImmediateFutureAwaiter(ImmediateFuture<T>&& future) noexcept
+      : future_{std::move(future)} {}
+
+  bool await_ready() const {
+    return future_.isReady();
+  }
+
+  template <typename Promise>
+  void await_suspend(folly::coro::coroutine_handle<Promise> handle) {
+    if constexpr (std::is_base_of_v<ImmediateTaskPromiseBase, Promise>) {
+      handle.promise().suspendedOn = std::move(future_).semi().deferTry(
+          [this](folly::Try<T>&& result) { result_ = std::move(result); });
+    } else {
+      std::move(future_).semi().toUnsafeFuture().thenTry(
+          [this, handle](folly::Try<T>&& result) {
+            result_ = std::move(result);
+            handle.resume();
+          });
+    }
+  }
+
+  T await_resume() {
+    if (result_.hasValue() || result_.hasException()) {
+      return std::move(result_).value();
+    }
+    // Never suspended: the future was ready.
+    return std::move(future_).get();
+  }
+
+ private:
+  ImmediateFuture<T> future_;
+  folly::Try<T> result_;
+};
+
+} // namespace detail
+#endif
+
 } // namespace facebook::eden
 
 #include "eden/common/utils/ImmediateFuture-inl.h"
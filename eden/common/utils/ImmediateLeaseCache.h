@@ -0,0 +1,426 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/executors/InlineExecutor.h>
+#include <folly/futures/SharedPromise.h>
+
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+
+#include "eden/common/utils/ImmediateFuture.h"
+#include "eden/common/utils/LeaseCache.h"
+#include "eden/common/utils/Synchronized.h"
+
+namespace facebook::eden {
+
+/**
+ * A LeaseCache whose fetcher and lookups return ImmediateFuture, and whose
+ * entries expire.
+ *
+ * A hit on a fetched value returns a ready ImmediateFuture holding a copy of
+ * the shared_ptr: unlike LeaseCache::get(), it allocates nothing. Only
+ * lookups that have to wait for a fetch get a SemiFuture.
+ *
+ * Fetched values are cached for ttl, or for as long as ttlFor says. Failed
+ * fetches are cached for negativeTtl, which is usually shorter, or not at
+ * all by default, so the next lookup fetches again.
+ *
+ * With refreshAhead, the first hit on a value due to expire within
+ * refreshAhead fetches it again in the background, while hits keep getting
+ * the cached value, so keys that are looked up often never wait for a
+ * fetch. A failed refresh leaves the cached value in place until it
+ * expires.
+ */
+template <typename KEY, typename VAL, typename HASH = std::hash<KEY>>
+class ImmediateLeaseCache {
+ public:
+  using ValuePtr = std::shared_ptr<VAL>;
+  using FutureType = ImmediateFuture<ValuePtr>;
+  using FetchFunc = std::function<FutureType(const KEY& key)>;
+  using Weigher = typename LeaseCache<KEY, VAL, HASH>::Weigher;
+  using Clock = std::chrono::steady_clock;
+  using TtlFunc =
+      std::function<std::chrono::nanoseconds(const KEY& key, const VAL& value)>;
+
+  static constexpr std::chrono::nanoseconds kForever =
+      std::chrono::nanoseconds::max();
+
+  struct Options {
+    size_t maxSize{std::numeric_limits<size_t>::max()};
+    /// How many entries to evict at once when maxSize is exceeded.
+    size_t clearSize{1};
+    /// Rounded up to a power of two, and lowered to at most maxSize.
+    size_t numShards{LeaseCache<KEY, VAL, HASH>::kDefaultNumShards};
+    /// Without a weigher, every value weighs 0.
+    Weigher weigher;
+    size_t maxWeight{std::numeric_limits<size_t>::max()};
+    std::shared_ptr<LeaseCacheObserver> observer;
+
+    /// How long a fetched value is cached.
+    std::chrono::nanoseconds ttl{kForever};
+    /// If set, overrides ttl for each fetched value.
+    TtlFunc ttlFor;
+    /// How long a failed fetch is cached. Zero to not cache failures.
+    std::chrono::nanoseconds negativeTtl{0};
+    /// How long before its expiry a value is refreshed. Zero to disable.
+    std::chrono::nanoseconds refreshAhead{0};
+    /// Runs refreshes, and completes fetches that were not ready right away.
+    /// Defaults to running them inline, which makes the hit that triggers a
+    /// refresh wait for the fetcher to return.
+    folly::Executor::KeepAlive<> executor;
+    /// For testing.
+    std::function<Clock::time_point()> now;
+  };
+
+ private:
+  using SharedPromisePtr = std::shared_ptr<folly::SharedPromise<ValuePtr>>;
+
+  struct Entry : detail::LeaseCacheEntryBase {
+    /// Empty until the first fetch completes.
+    folly::Try<ValuePtr> value;
+    Clock::time_point expiry;
+    Clock::time_point refreshAt{Clock::time_point::max()};
+    /// Set while a fetch or refresh is in progress.
+    SharedPromisePtr pending;
+    /// Identifies the latest fetch, whose result the entry is waiting for.
+    uint64_t fetchId{0};
+    /// Set by the hit that schedules a refresh.
+    mutable std::atomic<bool> refreshing{false};
+  };
+
+  using Shards = detail::LeaseCacheShards<KEY, Entry, HASH>;
+  using State = typename Shards::State;
+
+  /**
+   * What get() found under the lock.
+   */
+  struct Lookup {
+    /// A value to return right away.
+    folly::Try<ValuePtr> value;
+    /// Otherwise, the fetch to wait for.
+    SharedPromisePtr pending;
+    /// Whether the caller must start the fetch, whose id this is.
+    std::optional<uint64_t> fetchId;
+    /// Whether the caller must schedule a refresh.
+    bool refresh{false};
+  };
+
+  /**
+   * Fetches that complete after the cache is destroyed find it gone through
+   * a weak_ptr.
+   */
+  struct Core : Shards, std::enable_shared_from_this<Core> {
+    Core(Options options, FetchFunc fetcher)
+        : Shards{
+              options.maxSize,
+              options.clearSize,
+              options.numShards,
+              options.maxWeight,
+              std::move(options.observer)},
+          fetcher{std::move(fetcher)},
+          weigher{std::move(options.weigher)},
+          ttl{options.ttl},
+          ttlFor{std::move(options.ttlFor)},
+          negativeTtl{options.negativeTtl},
+          refreshAhead{options.refreshAhead},
+          executor{orInline(std::move(options.executor))},
+          clock{std::move(options.now)} {}
+
+    static folly::Executor::KeepAlive<> orInline(
+        folly::Executor::KeepAlive<> executor) {
+      if (executor) {
+        return executor;
+      }
+      return folly::getKeepAliveToken(folly::InlineExecutor::instance());
+    }
+
+    Clock::time_point now() const {
+      return clock ? clock() : Clock::now();
+    }
+
+    /// Unique across entries, so that a fetch for an entry that was evicted
+    /// is not mistaken for one of the entry that replaced it.
+    uint64_t newFetchId() {
+      return nextFetchId.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    const FetchFunc fetcher;
+    const Weigher weigher;
+    const std::chrono::nanoseconds ttl;
+    const TtlFunc ttlFor;
+    const std::chrono::nanoseconds negativeTtl;
+    const std::chrono::nanoseconds refreshAhead;
+    const folly::Executor::KeepAlive<> executor;
+    const std::function<Clock::time_point()> clock;
+    std::atomic<uint64_t> nextFetchId{0};
+  };
+
+  std::shared_ptr<Core> core_;
+
+ public:
+  ImmediateLeaseCache(Options options, FetchFunc fetcher)
+      : core_{std::make_shared<Core>(std::move(options), std::move(fetcher))} {}
+
+  FutureType get(const KEY& key) {
+    auto& core = *core_;
+    auto now = core.now();
+    auto& shard = core.shardFor(key);
+
+    auto lookup = tryRlockCheckBeforeUpdate<Lookup>(
+        shard.state,
+        [&](const State& state) -> std::optional<Lookup> {
+          auto it = state.map.find(key);
+          if (it == state.map.end()) {
+            return std::nullopt;
+          }
+          const auto& entry = it->second;
+          Lookup lookup;
+          if (hasValue(entry) && now < entry.expiry) {
+            lookup.value = entry.value;
+            lookup.refresh = now >= entry.refreshAt && !entry.pending &&
+                !entry.refreshing.load(std::memory_order_relaxed) &&
+                !entry.refreshing.exchange(true, std::memory_order_relaxed);
+          } else if (entry.pending) {
+            lookup.pending = entry.pending;
+          } else {
+            return std::nullopt;
+          }
+          core.hit(entry);
+          return lookup;
+        },
+        [&](auto& state) {
+          auto [node, inserted] = core.findOrInsert(*state, key);
+          auto& entry = node->second;
+          // The value, if any, expired.
+          entry.value = folly::Try<ValuePtr>{};
+          core.setWeight(*state, *node, 0);
+          Lookup lookup;
+          lookup.pending = startFetch(core, entry);
+          lookup.fetchId = entry.fetchId;
+          core.evictToFit(*state, node);
+          core.miss();
+          return lookup;
+        });
+
+    if (lookup.refresh) {
+      scheduleRefresh(key);
+    }
+    if (!lookup.pending) {
+      return FutureType{std::move(lookup.value)};
+    }
+    if (lookup.fetchId) {
+      fetch(core, key, *lookup.fetchId, lookup.pending);
+    }
+    return lookup.pending->getSemiFuture();
+  }
+
+  /**
+   * Cache val for ttl, or for as long as ttlFor says if ttl is not given,
+   * replacing any cached or pending value.
+   */
+  void set(
+      const KEY& key,
+      ValuePtr val,
+      std::optional<std::chrono::nanoseconds> ttl = std::nullopt) {
+    auto& core = *core_;
+    if (!ttl) {
+      ttl = core.ttlFor && val ? core.ttlFor(key, *val) : core.ttl;
+    }
+    size_t weight = core.weigher && val ? core.weigher(key, *val) : 0;
+    auto now = core.now();
+
+    auto state = core.shardFor(key).state.wlock();
+    auto [node, inserted] = core.findOrInsert(*state, key);
+    auto& entry = node->second;
+    // Ignore the result of any pending fetch.
+    entry.pending.reset();
+    entry.fetchId = core.newFetchId();
+    entry.refreshing.store(false, std::memory_order_relaxed);
+    entry.value = folly::Try<ValuePtr>{std::move(val)};
+    entry.expiry = expiryAfter(now, *ttl);
+    entry.refreshAt = refreshAtFor(core, entry.expiry, *ttl);
+    core.setWeight(*state, *node, weight);
+    core.evictToFit(*state, node);
+  }
+
+  void erase(const KEY& key) {
+    auto state = core_->shardFor(key).state.wlock();
+    auto it = state->map.find(key);
+    if (it != state->map.end()) {
+      core_->remove(*state, *it);
+    }
+  }
+
+  void setMaxSize(size_t size) {
+    core_->setMaxSize(size);
+  }
+
+  void setMaxWeight(size_t weight) {
+    core_->setMaxWeight(weight);
+  }
+
+  /**
+   * Whether key is cached or being fetched, even if its value has expired.
+   */
+  bool exists(const KEY& key) {
+    return core_->shardFor(key).state.rlock()->map.contains(key);
+  }
+
+  size_t size() const {
+    return core_->size();
+  }
+
+  size_t weight() const {
+    return core_->weight();
+  }
+
+ private:
+  static bool hasValue(const Entry& entry) {
+    return entry.value.hasValue() || entry.value.hasException();
+  }
+
+  static Clock::time_point expiryAfter(
+      Clock::time_point now,
+      std::chrono::nanoseconds ttl) {
+    auto left = Clock::time_point::max() - now;
+    if (ttl >= left) {
+      return Clock::time_point::max();
+    }
+    return now + std::chrono::duration_cast<Clock::duration>(ttl);
+  }
+
+  static Clock::time_point refreshAtFor(
+      const Core& core,
+      Clock::time_point expiry,
+      std::chrono::nanoseconds ttl) {
+    if (core.refreshAhead.count() <= 0 || expiry == Clock::time_point::max() ||
+        ttl <= core.refreshAhead) {
+      return Clock::time_point::max();
+    }
+    return expiry - std::chrono::duration_cast<Clock::duration>(
+                        core.refreshAhead);
+  }
+
+  static SharedPromisePtr startFetch(Core& core, Entry& entry) {
+    entry.pending = std::make_shared<typename SharedPromisePtr::element_type>();
+    entry.fetchId = core.newFetchId();
+    return entry.pending;
+  }
+
+  /**
+   * Call the fetcher, and record its result when it completes.
+   */
+  static void fetch(
+      Core& core,
+      const KEY& key,
+      uint64_t fetchId,
+      SharedPromisePtr promise) {
+    auto future = makeImmediateFutureWith([&] { return core.fetcher(key); });
+    auto complete = [weakCore = core.weak_from_this(),
+                     key,
+                     fetchId,
+                     promise = std::move(promise)](
+                        folly::Try<ValuePtr>&& result) {
+      if (auto core = weakCore.lock()) {
+        fetched(*core, key, fetchId, result);
+      }
+      promise->setTry(std::move(result));
+    };
+    if (future.isReady()) {
+      complete(std::move(future).getTry());
+    } else {
+      std::move(future).semi().via(core.executor).thenTry(std::move(complete));
+    }
+  }
+
+  /**
+   * Record the result of a fetch, unless its entry was evicted, replaced or
+   * fetched again in the meantime.
+   */
+  static void fetched(
+      Core& core,
+      const KEY& key,
+      uint64_t fetchId,
+      const folly::Try<ValuePtr>& result) {
+    auto now = core.now();
+    auto ttl = core.ttl;
+    size_t weight = 0;
+    if (result.hasValue() && result.value()) {
+      if (core.ttlFor) {
+        ttl = core.ttlFor(key, *result.value());
+      }
+      if (core.weigher) {
+        weight = core.weigher(key, *result.value());
+      }
+    }
+
+    auto state = core.shardFor(key).state.wlock();
+    auto it = state->map.find(key);
+    if (it == state->map.end() || it->second.fetchId != fetchId) {
+      return;
+    }
+    auto& entry = it->second;
+    entry.pending.reset();
+    entry.refreshing.store(false, std::memory_order_relaxed);
+
+    if (result.hasException()) {
+      if (hasValue(entry) && now < entry.expiry) {
+        // A failed refresh: keep serving the value until it expires.
+        return;
+      }
+      if (core.negativeTtl.count() <= 0) {
+        core.remove(*state, *it);
+        return;
+      }
+      ttl = core.negativeTtl;
+    }
+
+    entry.value = result;
+    entry.expiry = expiryAfter(now, ttl);
+    entry.refreshAt = result.hasException()
+        ? Clock::time_point::max()
+        : refreshAtFor(core, entry.expiry, ttl);
+    core.setWeight(*state, *it, weight);
+    core.evictToFit(*state, &*it);
+  }
+
+  /**
+   * Fetch key again on the executor, unless a fetch already started.
+   */
+  void scheduleRefresh(const KEY& key) {
+    core_->executor->add([weakCore = std::weak_ptr<Core>{core_}, key] {
+      auto core = weakCore.lock();
+      if (!core) {
+        return;
+      }
+      SharedPromisePtr promise;
+      uint64_t fetchId = 0;
+      {
+        auto state = core->shardFor(key).state.wlock();
+        auto it = state->map.find(key);
+        if (it == state->map.end()) {
+          return;
+        }
+        auto& entry = it->second;
+        if (entry.pending) {
+          entry.refreshing.store(false, std::memory_order_relaxed);
+          return;
+        }
+        promise = startFetch(*core, entry);
+        fetchId = entry.fetchId;
+      }
+      fetch(*core, key, fetchId, std::move(promise));
+    });
+  }
+};
+
+} // namespace facebook::eden
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/ImmediateTask.h"
+
+#if FOLLY_HAS_COROUTINES
+
+#include <folly/lang/Bits.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <new>
+
+namespace facebook::eden::detail {
+
+namespace {
+
+/**
+ * Frames are cached by size class: powers of two from 64 bytes to 8 KiB.
+ * Larger frames are rare enough to go straight to the allocator.
+ */
+constexpr size_t kMinSizeClassShift = 6;
+constexpr size_t kNumSizeClasses = 8;
+constexpr size_t kMaxCachedFramesPerClass = 16;
+
+struct FrameCache {
+  ~FrameCache();
+
+  std::array<std::array<void*, kMaxCachedFramesPerClass>, kNumSizeClasses>
+      frames{};
+  std::array<size_t, kNumSizeClasses> counts{};
+};
+
+enum class CacheState : uint8_t { Unused, Alive, Destroyed };
+
+// Frames freed while the thread exits, after the cache was destroyed, go back
+// to the allocator. A trivially destructible thread_local stays valid for
+// that long.
+thread_local CacheState cacheState{CacheState::Unused};
+thread_local FrameCache cache;
+
+FrameCache::~FrameCache() {
+  cacheState = CacheState::Destroyed;
+  for (size_t sizeClass = 0; sizeClass < kNumSizeClasses; ++sizeClass) {
+    for (size_t i = 0; i < counts[sizeClass]; ++i) {
+      ::operator delete(frames[sizeClass][i]);
+    }
+  }
+}
+
+size_t sizeClassOf(size_t size) {
+  auto shift = folly::findLastSet(std::max<size_t>(size, 1) - 1);
+  return shift <= kMinSizeClassShift ? 0 : shift - kMinSizeClassShift;
+}
+
+size_t sizeOfClass(size_t sizeClass) {
+  return size_t{1} << (sizeClass + kMinSizeClassShift);
+}
+
+FrameCache* getCache() {
+  switch (cacheState) {
+    case CacheState::Unused:
+      cacheState = CacheState::Alive;
+      return &cache;
+    case CacheState::Alive:
+      return &cache;
+    case CacheState::Destroyed:
+      break;
+  }
+  return nullptr;
+}
+
+} // namespace
+
+void* allocateImmediateTaskFrame(size_t size) {
+  auto sizeClass = sizeClassOf(size);
+  if (sizeClass >= kNumSizeClasses) {
+    return ::operator new(size);
+  }
+  auto* frameCache = getCache();
+  if (frameCache && frameCache->counts[sizeClass] > 0) {
+    return frameCache->frames[sizeClass][--frameCache->counts[sizeClass]];
+  }
+  return ::operator new(sizeOfClass(sizeClass));
+}
+
+void deallocateImmediateTaskFrame(void* frame, size_t size) noexcept {
+  auto sizeClass = sizeClassOf(size);
+  if (sizeClass < kNumSizeClasses && cacheState == CacheState::Alive) {
+    auto& count = cache.counts[sizeClass];
+    if (count < kMaxCachedFramesPerClass) {
+      cache.frames[sizeClass][count++] = frame;
+      return;
+    }
+  }
+  ::operator delete(frame);
+}
+
+} // namespace facebook::eden::detail
+
+#endif
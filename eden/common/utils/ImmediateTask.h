@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/Portability.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+#include <folly/coro/Coroutine.h>
+#include "eden/common/utils/ImmediateFuture.h"
+
+namespace facebook::eden {
+
+namespace detail {
+
+/**
+ * Allocate and free the frames of ImmediateTask coroutines. Freed frames
+ * are kept in a small per-thread cache, so that coroutines that run to
+ * completion on one thread stop reaching malloc once the cache is warm.
+ */
+void* allocateImmediateTaskFrame(size_t size);
+void deallocateImmediateTaskFrame(void* frame, size_t size) noexcept;
+
+} // namespace detail
+
+/**
+ * The return type of a coroutine that behaves like an ImmediateFuture.
+ *
+ * The coroutine starts running when called, and keeps running as long as
+ * the ImmediateFutures it awaits are ready, so that a coroutine whose values
+ * are all in memory completes synchronously: toImmediateFuture() then
+ * returns a ready ImmediateFuture, and no SemiFuture is ever allocated.
+ *
+ * When an awaited future is not ready, the coroutine suspends. It is resumed
+ * once the ImmediateFuture returned by toImmediateFuture() is consumed, on
+ * the consuming thread, just like a chain of thenValue() callbacks would be.
+ *
+ * ImmediateTask may await ImmediateFuture, folly::Future, folly::SemiFuture
+ * and other ImmediateTasks. Use ImmediateTask<folly::Unit> for coroutines
+ * without a result.
+ *
+ *   ImmediateTask<size_t> getSize(ObjectId id) {
+ *     auto blob = co_await store.getBlob(id);
+ *     co_return blob->getSize();
+ *   }
+ */
+template <typename T>
+class ImmediateTask {
+ public:
+  class promise_type : public detail::ImmediateTaskPromiseBase {
+   public:
+    ImmediateTask get_return_object() noexcept {
+      return ImmediateTask{Handle::from_promise(*this)};
+    }
+
+    folly::coro::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+
+    // The ImmediateTask, or the SemiFuture resuming it, destroys the frame.
+    folly::coro::suspend_always final_suspend() noexcept {
+      return {};
+    }
+
+    template <typename U = T>
+    void return_value(U&& value) {
+      result_.emplace(std::forward<U>(value));
+    }
+
+    void unhandled_exception() noexcept {
+      result_.emplaceException(
+          folly::exception_wrapper{std::current_exception()});
+    }
+
+    template <typename U>
+    detail::ImmediateFutureAwaiter<U> await_transform(
+        ImmediateFuture<U>&& future) noexcept {
+      return std::move(future).operator co_await();
+    }
+
+    template <typename U>
+    detail::ImmediateFutureAwaiter<U> await_transform(
+        folly::SemiFuture<U>&& future) noexcept {
+      return ImmediateFuture<U>{std::move(future)}.operator co_await();
+    }
+
+    template <typename U>
+    detail::ImmediateFutureAwaiter<U> await_transform(
+        folly::Future<U>&& future) noexcept {
+      return ImmediateFuture<U>{std::move(future)}.operator co_await();
+    }
+
+    template <typename U>
+    detail::ImmediateFutureAwaiter<U> await_transform(ImmediateTask<U>&& task) {
+      return std::move(task).operator co_await();
+    }
+
+    static void* operator new(size_t size) {
+      return detail::allocateImmediateTaskFrame(size);
+    }
+
+    static void operator delete(void* frame, size_t size) noexcept {
+      detail::deallocateImmediateTaskFrame(frame, size);
+    }
+
+   private:
+    friend class ImmediateTask;
+
+    folly::Try<T> result_;
+  };
+
+  ImmediateTask(ImmediateTask&& other) noexcept
+      : handle_{std::exchange(other.handle_, {})} {}
+
+  ImmediateTask& operator=(ImmediateTask&& other) noexcept {
+    if (this != &other) {
+      destroy();
+      handle_ = std::exchange(other.handle_, {});
+    }
+    return *this;
+  }
+
+  ~ImmediateTask() {
+    destroy();
+  }
+
+  /**
+   * Whether the coroutine ran to completion.
+   */
+  bool isReady() const {
+    return handle_ && handle_.done();
+  }
+
+  /**
+   * Returns the result of the coroutine: a ready ImmediateFuture if it ran
+   * to completion, and otherwise one that resumes it when consumed.
+   */
+  ImmediateFuture<T> toImmediateFuture() && {
+    Frame frame{std::exchange(handle_, {})};
+    if (!frame) {
+      throw folly::FutureInvalid();
+    }
+    if (frame.done()) {
+      return std::move(frame.promise().result_);
+    }
+    return resumeWhenReady(std::move(frame));
+  }
+
+  detail::ImmediateFutureAwaiter<T> operator co_await() && {
+    return std::move(*this).toImmediateFuture().operator co_await();
+  }
+
+ private:
+  using Handle = folly::coro::coroutine_handle<promise_type>;
+
+  /**
+   * Owns the coroutine frame.
+   */
+  class Frame {
+   public:
+    explicit Frame(Handle handle) noexcept : handle_{handle} {}
+
+    Frame(Frame&& other) noexcept : handle_{std::exchange(other.handle_, {})} {}
+
+    Frame& operator=(Frame&&) = delete;
+
+    ~Frame() {
+      if (handle_) {
+        handle_.destroy();
+      }
+    }
+
+    explicit operator bool() const {
+      return bool(handle_);
+    }
+
+    bool done() const {
+      return handle_.done();
+    }
+
+    void resume() {
+      handle_.resume();
+    }
+
+    promise_type& promise() {
+      return handle_.promise();
+    }
+
+   private:
+    Handle handle_;
+  };
+
+  explicit ImmediateTask(Handle handle) noexcept : handle_{handle} {}
+
+  void destroy() noexcept {
+    if (handle_) {
+      std::exchange(handle_, {}).destroy();
+    }
+  }
+
+  /**
+   * Chain the resumption of the suspended coroutine, and of every later
+   * suspension, to the future it is suspended on.
+   */
+  static folly::SemiFuture<T> resumeWhenReady(Frame frame) {
+    auto& promise = frame.promise();
+    auto suspendedOn = std::move(*promise.suspendedOn);
+    promise.suspendedOn.reset();
+    return std::move(suspendedOn)
+        .deferValue(
+            [frame = std::move(frame)](folly::Unit) mutable
+            -> folly::SemiFuture<T> {
+              frame.resume();
+              if (frame.done()) {
+                return std::move(frame.promise().result_);
+              }
+              return resumeWhenReady(std::move(frame));
+            });
+  }
+
+  Handle handle_;
+};
+
+} // namespace facebook::eden
+
+#endif
@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/small_vector.h>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#include "eden/common/utils/PathFuncs.h"
+#include "eden/common/utils/Throw.h"
+
+namespace facebook::eden {
+
+namespace detail {
+
+enum class IndexedPathIteratorKind { Prefix, Component, Suffix };
+
+/**
+ * An iterator over the prefixes, components or suffixes of an IndexedPath.
+ *
+ * Moving the iterator only changes an index into the owner's separator
+ * table, and dereferencing it slices the path, so neither rescans the path.
+ */
+template <
+    typename Owner,
+    typename Value,
+    IndexedPathIteratorKind Kind,
+    bool IsReverse>
+class IndexedPathIterator {
+ public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = const Value;
+  using difference_type = std::ptrdiff_t;
+  using pointer = value_type*;
+  using reference = value_type&;
+
+  IndexedPathIterator() = default;
+
+  IndexedPathIterator(const Owner* owner, size_t index)
+      : owner_{owner}, index_{index} {}
+
+  bool operator==(const IndexedPathIterator& other) const {
+    XDCHECK_EQ(owner_, other.owner_);
+    return index_ == other.index_;
+  }
+
+  bool operator!=(const IndexedPathIterator& other) const {
+    return !(*this == other);
+  }
+
+  IndexedPathIterator& operator++() {
+    // Reverse ranges may end one before index 0: let it wrap around.
+    index_ += IsReverse ? size_t(-1) : 1;
+    return *this;
+  }
+
+  IndexedPathIterator operator++(int) {
+    IndexedPathIterator tmp(*this);
+    ++(*this);
+    return tmp;
+  }
+
+  IndexedPathIterator& operator--() {
+    index_ += IsReverse ? 1 : size_t(-1);
+    return *this;
+  }
+
+  IndexedPathIterator operator--(int) {
+    IndexedPathIterator tmp(*this);
+    --(*this);
+    return tmp;
+  }
+
+  Value operator*() const {
+    if constexpr (Kind == IndexedPathIteratorKind::Prefix) {
+      return owner_->prefix(index_);
+    } else if constexpr (Kind == IndexedPathIteratorKind::Component) {
+      return owner_->component(index_);
+    } else {
+      return owner_->suffix(index_);
+    }
+  }
+
+  /**
+   * The index of the current element in the owner's table. For prefixes this
+   * is the number of components in the prefix.
+   */
+  size_t index() const {
+    return index_;
+  }
+
+ private:
+  const Owner* owner_{nullptr};
+  size_t index_{0};
+};
+
+} // namespace detail
+
+/**
+ * A RelativePathPiece or AbsolutePathPiece along with the offsets of its
+ * directory separators.
+ *
+ * The path iterators find the next separator on every step, and dirname(),
+ * findParent() and isSubDirOf() scan the string each time they are called.
+ * That is fine for a single pass, but code that walks paths() and
+ * rsuffixes() of the same path over and over, or climbs its ancestors with
+ * repeated dirname() calls, pays for those scans every time. IndexedPath
+ * scans the path once up front; after that, every ancestor, component and
+ * suffix is a slice of the path found by index.
+ *
+ * The ranges yield the same elements as the methods of the same name on the
+ * path types. IndexedPath does not own the path: it must not outlive the
+ * string it was built from.
+ */
+template <typename Piece>
+class IndexedPath {
+  static_assert(
+      std::is_same_v<Piece, RelativePathPiece> ||
+      std::is_same_v<Piece, AbsolutePathPiece>);
+
+  static constexpr bool kIsAbsolute = std::is_same_v<Piece, AbsolutePathPiece>;
+
+  /**
+   * Most paths are well under 16 components deep, so the table normally
+   * lives inline.
+   */
+  using Offsets = folly::small_vector<uint32_t, 16>;
+
+ public:
+  using iterator = detail::IndexedPathIterator<
+      IndexedPath,
+      Piece,
+      detail::IndexedPathIteratorKind::Prefix,
+      false>;
+  using reverse_iterator = detail::IndexedPathIterator<
+      IndexedPath,
+      Piece,
+      detail::IndexedPathIteratorKind::Prefix,
+      true>;
+  using component_iterator = detail::IndexedPathIterator<
+      IndexedPath,
+      PathComponentPiece,
+      detail::IndexedPathIteratorKind::Component,
+      false>;
+  using reverse_component_iterator = detail::IndexedPathIterator<
+      IndexedPath,
+      PathComponentPiece,
+      detail::IndexedPathIteratorKind::Component,
+      true>;
+  using suffix_iterator = detail::IndexedPathIterator<
+      IndexedPath,
+      RelativePathPiece,
+      detail::IndexedPathIteratorKind::Suffix,
+      false>;
+  using reverse_suffix_iterator = detail::IndexedPathIterator<
+      IndexedPath,
+      RelativePathPiece,
+      detail::IndexedPathIteratorKind::Suffix,
+      true>;
+
+  using iterator_range = PathIteratorRange<iterator>;
+  using reverse_iterator_range = PathIteratorRange<reverse_iterator>;
+  using component_iterator_range = PathIteratorRange<component_iterator>;
+  using reverse_component_iterator_range =
+      PathIteratorRange<reverse_component_iterator>;
+  using suffix_iterator_range = PathIteratorRange<suffix_iterator>;
+  using reverse_suffix_iterator_range =
+      PathIteratorRange<reverse_suffix_iterator>;
+
+  explicit IndexedPath(Piece path) : path_{path} {
+    auto view = path_.view();
+    if (view.size() > std::numeric_limits<uint32_t>::max()) {
+      throw_<std::length_error>(
+          "path is too long to index: ", view.size(), " bytes");
+    }
+    if constexpr (kIsAbsolute) {
+      begin_ = detail::kRootStr.size();
+    }
+    if (view.size() <= begin_) {
+      return;
+    }
+    size_t pos = begin_;
+    while (true) {
+      auto sep = detail::findPathSeparator(view, pos);
+      if (sep == std::string_view::npos) {
+        ends_.push_back(static_cast<uint32_t>(view.size()));
+        break;
+      }
+      ends_.push_back(static_cast<uint32_t>(sep));
+      pos = sep + 1;
+    }
+  }
+
+  // The iterators point back at this object.
+  IndexedPath(const IndexedPath&) = delete;
+  IndexedPath& operator=(const IndexedPath&) = delete;
+
+  Piece path() const {
+    return path_;
+  }
+
+  /**
+   * Number of components in the path.
+   */
+  size_t depth() const {
+    return ends_.size();
+  }
+
+  /**
+   * The component at index, which must be less than depth().
+   */
+  PathComponentPiece component(size_t index) const {
+    XDCHECK_LT(index, depth());
+    auto start = componentStart(index);
+    return PathComponentPiece{
+        path_.view().substr(start, ends_[index] - start),
+        detail::SkipPathSanityCheck{}};
+  }
+
+  /**
+   * The ancestor made of the first `count` components, which must not be
+   * greater than depth(). prefix(0) is the empty path for a relative path
+   * and the root for an absolute one.
+   */
+  Piece prefix(size_t count) const {
+    XDCHECK_LE(count, depth());
+    size_t end = count == 0 ? (kIsAbsolute ? begin_ : 0) : ends_[count - 1];
+    return Piece{path_.view().substr(0, end), detail::SkipPathSanityCheck{}};
+  }
+
+  /**
+   * The path starting at the component at index, which must not be greater
+   * than depth(). suffix(depth()) is the empty path.
+   */
+  RelativePathPiece suffix(size_t index) const {
+    XDCHECK_LE(index, depth());
+    if (index == depth()) {
+      return RelativePathPiece{};
+    }
+    return RelativePathPiece{
+        path_.view().substr(componentStart(index)),
+        detail::SkipPathSanityCheck{}};
+  }
+
+  /// Same as path().basename().
+  PathComponentPiece basename() const {
+    if (ends_.empty()) {
+      return path_.basename();
+    }
+    return component(depth() - 1);
+  }
+
+  /// Same as path().dirname().
+  Piece dirname() const {
+    if (depth() <= 1) {
+      return path_.dirname();
+    }
+    return prefix(depth() - 1);
+  }
+
+  /// Same as path().paths().
+  iterator_range paths() const {
+    return iterator_range{
+        iterator{this, kIsAbsolute ? 0 : 1}, iterator{this, depth() + 1}};
+  }
+
+  /// Same as path().allPaths().
+  iterator_range allPaths() const {
+    return iterator_range{iterator{this, 0}, iterator{this, depth() + 1}};
+  }
+
+  /// Same as path().rpaths().
+  reverse_iterator_range rpaths() const {
+    return reverse_iterator_range{
+        reverse_iterator{this, depth()},
+        reverse_iterator{this, kIsAbsolute ? size_t(-1) : 0}};
+  }
+
+  /// Same as path().rallPaths().
+  reverse_iterator_range rallPaths() const {
+    return reverse_iterator_range{
+        reverse_iterator{this, depth()}, reverse_iterator{this, size_t(-1)}};
+  }
+
+  /// Same as path().components().
+  component_iterator_range components() const {
+    return component_iterator_range{
+        component_iterator{this, 0}, component_iterator{this, depth()}};
+  }
+
+  /// Same as path().rcomponents().
+  reverse_component_iterator_range rcomponents() const {
+    return reverse_component_iterator_range{
+        reverse_component_iterator{this, depth() - 1},
+        reverse_component_iterator{this, size_t(-1)}};
+  }
+
+  /// Same as path().suffixes().
+  suffix_iterator_range suffixes() const {
+    return suffix_iterator_range{
+        suffix_iterator{this, 0}, suffix_iterator{this, depth()}};
+  }
+
+  /// Same as path().rsuffixes().
+  reverse_suffix_iterator_range rsuffixes() const {
+    return reverse_suffix_iterator_range{
+        reverse_suffix_iterator{this, depth() - 1},
+        reverse_suffix_iterator{this, size_t(-1)}};
+  }
+
+  /**
+   * Return an iterator in allPaths() pointing at parent if it is a strict
+   * ancestor of this path, or allPaths().end() otherwise.
+   *
+   * Only the bytes of parent are compared: the separator table locates the
+   * matching prefix with a binary search.
+   */
+  iterator findParent(Piece parent) const {
+    auto end = allPaths().end();
+    auto view = path_.view();
+    auto parentView = parent.view();
+    if (view.size() <= parentView.size()) {
+      return end;
+    }
+    size_t count;
+    if (parentView.size() == prefix(0).view().size()) {
+      count = 0;
+    } else {
+      auto it = std::lower_bound(ends_.begin(), ends_.end(), parentView.size());
+      if (it == ends_.end() || *it != parentView.size()) {
+        return end;
+      }
+      count = static_cast<size_t>(it - ends_.begin()) + 1;
+    }
+    if (view.substr(0, parentView.size()) != parentView) {
+      return end;
+    }
+    return iterator{this, count};
+  }
+
+  /**
+   * Same as path().isSubDirOf(parent): true if parent is a strict ancestor
+   * of this path.
+   */
+  bool isSubDirOf(Piece parent) const {
+    return findParent(parent) != allPaths().end();
+  }
+
+  /**
+   * Same as isSubDirOf(parent.path()), but only looks at the one separator
+   * of this path that can end parent before comparing bytes.
+   */
+  bool isSubDirOf(const IndexedPath& parent) const {
+    auto parentDepth = parent.depth();
+    if (parentDepth >= depth()) {
+      return false;
+    }
+    auto parentView = parent.path().view();
+    if (parentDepth > 0 && ends_[parentDepth - 1] != parentView.size()) {
+      return false;
+    }
+    return path_.view().substr(0, parentView.size()) == parentView;
+  }
+
+ private:
+  size_t componentStart(size_t index) const {
+    return index == 0 ? begin_ : ends_[index - 1] + 1;
+  }
+
+  Piece path_;
+  /// Offset of the first component: past the root of an absolute path.
+  size_t begin_{0};
+  /// Offset one past the end of each component.
+  Offsets ends_;
+};
+
+using IndexedRelativePath = IndexedPath<RelativePathPiece>;
+using IndexedAbsolutePath = IndexedPath<AbsolutePathPiece>;
+
+} // namespace facebook::eden
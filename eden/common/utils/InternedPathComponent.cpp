@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/InternedPathComponent.h"
+
+#include <folly/Indestructible.h>
+#include <folly/SharedMutex.h>
+#include <folly/container/F14Set.h>
+#include <folly/lang/Align.h>
+#include <folly/memory/Arena.h>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+
+#include "eden/common/utils/Throw.h"
+
+namespace facebook::eden {
+
+namespace {
+
+using Entry = detail::InternedPathComponentEntry;
+
+constexpr size_t kShardBits = 6;
+constexpr size_t kShardCount = size_t{1} << kShardBits;
+
+/**
+ * Heterogeneous lookup key, so a name can be found without first copying it
+ * into the arena.
+ */
+struct Lookup {
+  std::string_view name;
+  uint64_t hash;
+};
+
+struct EntryHash {
+  using is_transparent = void;
+  // The cached hash is a SpookyHash, so F14 doesn't need to mix it again.
+  using folly_is_avalanching = std::true_type;
+
+  size_t operator()(const Entry* entry) const {
+    return entry->hash;
+  }
+  size_t operator()(const Lookup& lookup) const {
+    return lookup.hash;
+  }
+};
+
+struct EntryEqual {
+  using is_transparent = void;
+
+  bool operator()(const Entry* a, const Entry* b) const {
+    return a == b;
+  }
+  bool operator()(const Lookup& a, const Entry* b) const {
+    return a.hash == b->hash && a.name == b->view();
+  }
+  bool operator()(const Entry* a, const Lookup& b) const {
+    return (*this)(b, a);
+  }
+};
+
+} // namespace
+
+struct alignas(folly::hardware_destructive_interference_size)
+    PathComponentInterner::Shard {
+  mutable folly::SharedMutex mutex;
+  folly::F14FastSet<const Entry*, EntryHash, EntryEqual> entries;
+  folly::SysArena arena;
+};
+
+PathComponentInterner::PathComponentInterner()
+    : shards_{std::make_unique<Shard[]>(kShardCount)} {}
+
+PathComponentInterner::~PathComponentInterner() = default;
+
+InternedPathComponent PathComponentInterner::intern(PathComponentPiece name) {
+  auto view = name.view();
+  if (view.size() > std::numeric_limits<uint32_t>::max()) {
+    throwf<std::length_error>(
+        "path component of {} bytes is too long to intern", view.size());
+  }
+
+  Lookup lookup{view, std::hash<PathComponentPiece>{}(name)};
+  // F14 uses the low bits of the hash; pick the shard from the high bits.
+  auto& shard = shards_[lookup.hash >> (64 - kShardBits)];
+
+  {
+    std::shared_lock lock{shard.mutex};
+    auto it = shard.entries.find(lookup);
+    if (it != shard.entries.end()) {
+      return InternedPathComponent{*it};
+    }
+  }
+
+  std::unique_lock lock{shard.mutex};
+  auto it = shard.entries.find(lookup);
+  if (it != shard.entries.end()) {
+    return InternedPathComponent{*it};
+  }
+
+  void* mem = shard.arena.allocate(sizeof(Entry) + view.size());
+  auto* entry =
+      new (mem) Entry{lookup.hash, static_cast<uint32_t>(view.size())};
+  std::memcpy(reinterpret_cast<char*>(entry + 1), view.data(), view.size());
+  shard.entries.insert(entry);
+  return InternedPathComponent{entry};
+}
+
+size_t PathComponentInterner::size() const {
+  size_t total = 0;
+  for (size_t i = 0; i < kShardCount; ++i) {
+    std::shared_lock lock{shards_[i].mutex};
+    total += shards_[i].entries.size();
+  }
+  return total;
+}
+
+PathComponentInterner& PathComponentInterner::getDefault() {
+  static folly::Indestructible<PathComponentInterner> interner;
+  return *interner;
+}
+
+InternedPathComponent::InternedPathComponent(PathComponentPiece name)
+    : InternedPathComponent{PathComponentInterner::getDefault().intern(name)} {}
+
+} // namespace facebook::eden
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <fmt/format.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include "eden/common/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+class InternedPathComponent;
+
+namespace detail {
+
+/**
+ * A name stored by PathComponentInterner. The bytes of the name immediately
+ * follow this header in the interner's arena. Entries are never moved or
+ * freed for the lifetime of the interner that owns them.
+ */
+struct InternedPathComponentEntry {
+  uint64_t hash;
+  uint32_t size;
+
+  const char* data() const {
+    return reinterpret_cast<const char*>(this + 1);
+  }
+
+  std::string_view view() const {
+    return std::string_view{data(), size};
+  }
+};
+
+} // namespace detail
+
+/**
+ * An append-only table of unique PathComponent strings.
+ *
+ * Source control trees repeat the same handful of names (".gitignore",
+ * "BUCK", "src", "__init__.py", ...) millions of times. Interning them stores
+ * each distinct name exactly once and lets callers compare names by pointer.
+ *
+ * The table is sharded by hash and each shard is guarded by a reader-writer
+ * lock, so interning names that already exist only takes a shared lock.
+ * Memory is never reclaimed: every InternedPathComponent handed out remains
+ * valid until the interner is destroyed.
+ */
+class PathComponentInterner {
+ public:
+  PathComponentInterner();
+  ~PathComponentInterner();
+
+  PathComponentInterner(const PathComponentInterner&) = delete;
+  PathComponentInterner& operator=(const PathComponentInterner&) = delete;
+
+  /**
+   * Return the handle for `name`, storing a copy of it if this is the first
+   * time it has been seen. Thread-safe.
+   */
+  InternedPathComponent intern(PathComponentPiece name);
+
+  /**
+   * Number of distinct names stored.
+   */
+  size_t size() const;
+
+  /**
+   * The process-wide interner used by InternedPathComponent's converting
+   * constructor. It is never destroyed.
+   */
+  static PathComponentInterner& getDefault();
+
+ private:
+  struct Shard;
+
+  std::unique_ptr<Shard[]> shards_;
+};
+
+/**
+ * A handle to a PathComponent stored in a PathComponentInterner.
+ *
+ * It is a single pointer: copying is free, equality is a pointer comparison
+ * and the hash is cached at interning time (and matches the hash of the
+ * equivalent PathComponentPiece). It converts to PathComponentPiece, so it can
+ * be used as the Key of a PathMap.
+ *
+ * Handles from different interners never compare equal, even for the same
+ * name; mixing interners is almost certainly a bug.
+ */
+class InternedPathComponent {
+ public:
+  using piece_type = PathComponentPiece;
+
+  /**
+   * Intern `name` in PathComponentInterner::getDefault().
+   */
+  explicit InternedPathComponent(PathComponentPiece name);
+
+  PathComponentPiece piece() const {
+    return PathComponentPiece{entry_->view(), detail::SkipPathSanityCheck{}};
+  }
+
+  /* implicit */ operator PathComponentPiece() const {
+    return piece();
+  }
+
+  std::string_view view() const {
+    return entry_->view();
+  }
+
+  size_t hash() const {
+    return entry_->hash;
+  }
+
+  friend bool operator==(InternedPathComponent a, InternedPathComponent b) {
+    return a.entry_ == b.entry_;
+  }
+
+  friend bool operator!=(InternedPathComponent a, InternedPathComponent b) {
+    return a.entry_ != b.entry_;
+  }
+
+ private:
+  explicit InternedPathComponent(const detail::InternedPathComponentEntry* e)
+      : entry_{e} {}
+
+  const detail::InternedPathComponentEntry* entry_;
+
+  friend class PathComponentInterner;
+};
+
+} // namespace facebook::eden
+
+namespace std {
+template <>
+struct hash<facebook::eden::InternedPathComponent> {
+  size_t operator()(facebook::eden::InternedPathComponent name) const {
+    return name.hash();
+  }
+};
+} // namespace std
+
+template <>
+struct fmt::formatter<facebook::eden::InternedPathComponent>
+    : formatter<string_view> {
+  template <typename Context>
+  auto format(facebook::eden::InternedPathComponent name, Context& ctx) const {
+    return formatter<string_view>::format(name.view(), ctx);
+  }
+};
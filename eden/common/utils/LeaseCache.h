@@ -6,12 +6,325 @@
  */
 
 #pragma once
-#include <folly/container/EvictingCacheMap.h>
+#include <folly/Synchronized.h>
+#include <folly/bits.h>
+#include <folly/container/F14Map.h>
+#include <folly/executors/GlobalExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/SharedPromise.h>
+#include <folly/hash/Hash.h>
+#include <folly/lang/Align.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "eden/common/utils/Synchronized.h"
 
 namespace facebook::eden {
 
+/**
+ * Receives the events of a LeaseCache, to export them as statistics. See
+ * LeaseCacheStatsObserver in eden/common/telemetry for one that records
+ * them in a StatsGroup.
+ *
+ * The methods are called while a shard of the cache is locked, so they must
+ * be cheap and must not call back into the cache.
+ */
+class LeaseCacheObserver {
+ public:
+  virtual ~LeaseCacheObserver() = default;
+
+  /// A get() found its key in the cache.
+  virtual void hit() = 0;
+
+  /// A get() did not find its key and started a fetch.
+  virtual void miss() = 0;
+
+  /// An entry of the given weight was evicted to make room.
+  virtual void evicted(size_t weight) = 0;
+
+  /// The total weight of the cache changed by delta.
+  virtual void weightChanged(int64_t delta) = 0;
+};
+
+namespace detail {
+
+/**
+ * What the eviction of LeaseCacheShards needs from an entry.
+ */
+struct LeaseCacheEntryBase {
+  /// Set by hits, cleared as the clock hand passes.
+  mutable std::atomic<bool> referenced{true};
+  /// Position of the entry in the shard's clock.
+  size_t clockIndex{0};
+  size_t weight{0};
+};
+
+/**
+ * The sharded map behind LeaseCache and ImmediateLeaseCache, which bounds
+ * the number and total weight of its entries and evicts them with the CLOCK
+ * algorithm. ENTRY must derive from LeaseCacheEntryBase.
+ *
+ * Both limits are divided between the shards, so the map may start evicting
+ * before reaching them when keys are not spread evenly. A maxSize of 0 means
+ * no limit, like EvictingCacheMap. There are no more shards than maxSize
+ * allows entries, so that the map never exceeds maxSize, unless setMaxSize()
+ * later lowers it below the number of shards: every shard still holds one
+ * entry then, so that an entry being fetched is never evicted.
+ */
+template <typename KEY, typename ENTRY, typename HASH>
+class LeaseCacheShards {
+ public:
+  // Node map: entries must not move, the clock points at them.
+  using Map = folly::F14NodeMap<KEY, ENTRY, HASH>;
+  using Node = typename Map::value_type;
+
+  struct State {
+    Map map;
+    std::vector<Node*> clock;
+    size_t hand{0};
+    size_t weight{0};
+    // This shard's share of the limits.
+    size_t maxSize{0};
+    size_t maxWeight{0};
+  };
+
+  struct alignas(folly::hardware_destructive_interference_size) Shard {
+    folly::Synchronized<State> state;
+  };
+
+  LeaseCacheShards(
+      size_t maxSize,
+      size_t clearSize,
+      size_t numShards,
+      size_t maxWeight,
+      std::shared_ptr<LeaseCacheObserver> observer)
+      : numShards_{shardCount(numShards, maxSize)},
+        shards_{std::make_unique<Shard[]>(numShards_)},
+        clearSize_{std::max<size_t>(
+            1, clearSize / numShards_ + (clearSize % numShards_ != 0))},
+        observer_{std::move(observer)} {
+    for (size_t i = 0; i < numShards_; ++i) {
+      auto state = shards_[i].state.wlock();
+      state->maxSize = sizeShare(maxSize, i);
+      state->maxWeight = share(maxWeight, i);
+    }
+  }
+
+  Shard& shardFor(const KEY& key) const {
+    // HASH need not mix its bits: std::hash of an integer is the identity.
+    auto hash = folly::hash::twang_mix64(HASH{}(key));
+    return shards_[hash & (numShards_ - 1)];
+  }
+
+  /**
+   * Find the entry for key, or insert one constructed from args, without
+   * evicting anything. Returns whether it was inserted.
+   */
+  template <typename... Args>
+  std::pair<Node*, bool>
+  findOrInsert(State& state, const KEY& key, Args&&... args) {
+    auto [it, inserted] =
+        state.map.try_emplace(key, std::forward<Args>(args)...);
+    if (inserted) {
+      it->second.clockIndex = state.clock.size();
+      state.clock.push_back(&*it);
+    } else {
+      it->second.referenced.store(true, std::memory_order_relaxed);
+    }
+    return {&*it, inserted};
+  }
+
+  /**
+   * Record a hit on entry, which may be shared with other readers.
+   */
+  void hit(const ENTRY& entry) const {
+    // Avoid writing to the shared cache line if the bit is set.
+    if (!entry.referenced.load(std::memory_order_relaxed)) {
+      entry.referenced.store(true, std::memory_order_relaxed);
+    }
+    if (observer_) {
+      observer_->hit();
+    }
+  }
+
+  void miss() const {
+    if (observer_) {
+      observer_->miss();
+    }
+  }
+
+  void setWeight(State& state, Node& node, size_t weight) const {
+    auto delta =
+        static_cast<int64_t>(weight) - static_cast<int64_t>(node.second.weight);
+    if (delta == 0) {
+      return;
+    }
+    state.weight = state.weight - node.second.weight + weight;
+    node.second.weight = weight;
+    if (observer_) {
+      observer_->weightChanged(delta);
+    }
+  }
+
+  void remove(State& state, Node& node) const {
+    setWeight(state, node, 0);
+    // Fill the hole with the last entry, which the hand then visits next.
+    auto clockIndex = node.second.clockIndex;
+    auto* last = state.clock.back();
+    state.clock[clockIndex] = last;
+    last->second.clockIndex = clockIndex;
+    state.clock.pop_back();
+    state.map.erase(state.map.find(node.first));
+  }
+
+  /**
+   * Evict entries until the shard is within its limits. When there are too
+   * many entries, evict clearSize of them at once, like EvictingCacheMap,
+   * but never `keep`. When the shard is too heavy, `keep` may go too, if it
+   * alone exceeds the budget.
+   */
+  void evictToFit(State& state, const Node* keep) const {
+    auto maxSize = state.maxSize;
+    if (state.map.size() > maxSize) {
+      auto target = maxSize + 1 > clearSize_ ? maxSize + 1 - clearSize_ : 0;
+      target = std::max<size_t>(target, keep ? 1 : 0);
+      while (state.map.size() > target) {
+        evictOne(state, keep);
+      }
+    }
+
+    while (state.weight > state.maxWeight) {
+      evictOne(state, nullptr);
+    }
+  }
+
+  void setMaxSize(size_t size) {
+    for (size_t i = 0; i < numShards_; ++i) {
+      auto state = shards_[i].state.wlock();
+      state->maxSize = sizeShare(size, i);
+      evictToFit(*state, nullptr);
+    }
+  }
+
+  void setMaxWeight(size_t weight) {
+    for (size_t i = 0; i < numShards_; ++i) {
+      auto state = shards_[i].state.wlock();
+      state->maxWeight = share(weight, i);
+      evictToFit(*state, nullptr);
+    }
+  }
+
+  size_t size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < numShards_; ++i) {
+      total += shards_[i].state.rlock()->map.size();
+    }
+    return total;
+  }
+
+  size_t weight() const {
+    size_t total = 0;
+    for (size_t i = 0; i < numShards_; ++i) {
+      total += shards_[i].state.rlock()->weight;
+    }
+    return total;
+  }
+
+ private:
+  /**
+   * The requested number of shards, rounded up to a power of two, but never
+   * more than maxSize, so that every shard may hold at least one entry.
+   */
+  static size_t shardCount(size_t numShards, size_t maxSize) {
+    auto count = folly::nextPowTwo(std::max<size_t>(1, numShards));
+    while (count > 1 && maxSize != 0 && count > maxSize) {
+      count /= 2;
+    }
+    return count;
+  }
+
+  /**
+   * The part of limit that shard `index` gets: the shares add up to limit.
+   */
+  size_t share(size_t limit, size_t index) const {
+    return limit / numShards_ + (index < limit % numShards_);
+  }
+
+  /**
+   * The entries shard `index` may hold, which is never 0: a shard must keep
+   * the entry being fetched, for other lookups of its key to share the fetch.
+   */
+  size_t sizeShare(size_t maxSize, size_t index) const {
+    if (maxSize == 0) {
+      return std::numeric_limits<size_t>::max();
+    }
+    return std::max<size_t>(1, share(maxSize, index));
+  }
+
+  /**
+   * Advance the clock hand to the first entry whose reference bit is clear,
+   * clearing the bits it passes, and evict that entry.
+   */
+  void evictOne(State& state, const Node* keep) const {
+    while (true) {
+      if (state.hand >= state.clock.size()) {
+        state.hand = 0;
+      }
+      auto* node = state.clock[state.hand];
+      if (node != keep &&
+          !node->second.referenced.exchange(false, std::memory_order_relaxed)) {
+        if (observer_) {
+          observer_->evicted(node->second.weight);
+        }
+        remove(state, *node);
+        return;
+      }
+      ++state.hand;
+    }
+  }
+
+  const size_t numShards_;
+  const std::unique_ptr<Shard[]> shards_;
+  const size_t clearSize_;
+  const std::shared_ptr<LeaseCacheObserver> observer_;
+};
+
+} // namespace detail
+
+/**
+ * A cache of values fetched asynchronously, where concurrent requests for a
+ * key that is not cached yet share a single fetch.
+ *
+ * The cache is split into independently locked shards, chosen by HASH, so
+ * that threads working on different keys rarely contend. Within a shard,
+ * lookups only take a shared lock: rather than reordering an LRU list on
+ * every hit, eviction approximates LRU with the CLOCK algorithm, and a hit
+ * merely sets the entry's reference bit, if it wasn't set already.
+ *
+ * The cache holds at most maxSize entries (0 for no limit) and, if a weigher
+ * is configured, at most maxWeight worth of values, where the weight of a
+ * value is known once it is fetched. setMaxSize() below the number of shards
+ * still leaves room for one entry per shard.
+ *
+ * With a batchFetcher, misses are fetched many keys at a time: those of a
+ * getBatch() call together, and those of get() calls that arrive within
+ * batchWindow of each other, up to maxBatchSize keys per batch. Every key
+ * is still fetched at most once at a time.
+ *
+ * Failed fetches stay cached until evicted or erased. See ImmediateLeaseCache
+ * for a cache whose entries expire.
+ */
 template <typename KEY, typename VAL, typename HASH = std::hash<KEY>>
 class LeaseCache {
  public:
@@ -20,57 +333,394 @@ class LeaseCache {
   using SharedPromiseType = std::shared_ptr<folly::SharedPromise<ValuePtr>>;
   using FetchFunc = std::function<FutureType(const KEY& key)>;
 
+  /**
+   * Fetches every key in keys, returning one result per key, in the same
+   * order.
+   */
+  using BatchFetchFunc = std::function<folly::Future<
+      std::vector<folly::Try<ValuePtr>>>(std::vector<KEY> keys)>;
+
+  /**
+   * Returns the cost of caching a value, typically its size in bytes.
+   */
+  using Weigher = std::function<size_t(const KEY& key, const VAL& value)>;
+
+  static constexpr size_t kDefaultNumShards = 16;
+
+  struct Options {
+    size_t maxSize{std::numeric_limits<size_t>::max()};
+    /// How many entries to evict at once when maxSize is exceeded.
+    size_t clearSize{1};
+    /// Rounded up to a power of two, and lowered to at most maxSize.
+    size_t numShards{kDefaultNumShards};
+    /// Without a weigher, every value weighs 0.
+    Weigher weigher;
+    size_t maxWeight{std::numeric_limits<size_t>::max()};
+    std::shared_ptr<LeaseCacheObserver> observer;
+
+    /// If set, used for every fetch in place of the FetchFunc.
+    BatchFetchFunc batchFetcher;
+    /// The most keys passed to batchFetcher at once.
+    size_t maxBatchSize{256};
+    /// How long the miss of a get() waits for others to fetch along with.
+    /// The batch is then fetched on executor. Zero to fetch right away.
+    std::chrono::microseconds batchWindow{0};
+    /// Runs the batches whose window elapsed. Defaults to the global CPU
+    /// executor.
+    folly::Executor::KeepAlive<> executor;
+    /// Times the batch window. Defaults to the global Timekeeper.
+    folly::Timekeeper* timekeeper{nullptr};
+  };
+
  private:
-  std::mutex lock_;
-  folly::EvictingCacheMap<KEY, SharedPromiseType, HASH> cache_;
-  FetchFunc fetcher_;
+  struct Entry : detail::LeaseCacheEntryBase {
+    explicit Entry(SharedPromiseType p) : promise{std::move(p)} {}
+
+    SharedPromiseType promise;
+  };
+
+  using Shards = detail::LeaseCacheShards<KEY, Entry, HASH>;
+  using State = typename Shards::State;
+
+  /**
+   * A key whose fetch is up to the caller.
+   */
+  struct Miss {
+    KEY key;
+    SharedPromiseType promise;
+  };
+
+  /**
+   * The misses waiting for the batch window to elapse.
+   */
+  struct Batcher {
+    std::vector<Miss> misses;
+    /// Incremented when misses is taken, to disarm the timer.
+    uint64_t generation{0};
+    bool timerArmed{false};
+  };
+
+  /**
+   * Fetches that complete after the LeaseCache is destroyed find it gone
+   * through a weak_ptr.
+   */
+  struct Core : Shards {
+    Core(Options options, FetchFunc fetcher)
+        : Shards{
+              options.maxSize,
+              options.clearSize,
+              options.numShards,
+              options.maxWeight,
+              std::move(options.observer)},
+          fetcher{std::move(fetcher)},
+          weigher{std::move(options.weigher)},
+          batchFetcher{std::move(options.batchFetcher)},
+          maxBatchSize{std::max<size_t>(1, options.maxBatchSize)},
+          batchWindow{options.batchWindow},
+          executor{std::move(options.executor)},
+          timekeeper{options.timekeeper} {}
+
+    const FetchFunc fetcher;
+    const Weigher weigher;
+    const BatchFetchFunc batchFetcher;
+    const size_t maxBatchSize;
+    const std::chrono::microseconds batchWindow;
+    // Null for the global CPU executor, only created once needed.
+    const folly::Executor::KeepAlive<> executor;
+    folly::Timekeeper* const timekeeper;
+    folly::Synchronized<Batcher, std::mutex> batcher;
+  };
+
+  std::shared_ptr<Core> core_;
 
  public:
-  LeaseCache(size_t maxSize, FetchFunc fetcher, size_t clearSize = 1)
-      : cache_(maxSize, clearSize), fetcher_(fetcher) {}
+  LeaseCache(
+      size_t maxSize,
+      FetchFunc fetcher,
+      size_t clearSize = 1,
+      size_t numShards = kDefaultNumShards)
+      : LeaseCache{
+            makeOptions(maxSize, clearSize, numShards),
+            std::move(fetcher)} {}
+
+  /**
+   * fetcher may be empty if options has a batchFetcher.
+   */
+  LeaseCache(Options options, FetchFunc fetcher)
+      : core_{std::make_shared<Core>(std::move(options), std::move(fetcher))} {
+  }
 
   void set(const KEY& key, ValuePtr val) {
-    std::lock_guard<std::mutex> g(lock_);
-    auto entry = std::make_shared<typename SharedPromiseType::element_type>();
-    entry->setValue(val);
-    cache_.set(key, entry);
+    size_t weight = core_->weigher && val ? core_->weigher(key, *val) : 0;
+    auto promise = std::make_shared<typename SharedPromiseType::element_type>();
+    promise->setValue(val);
+    auto state = core_->shardFor(key).state.wlock();
+    auto [node, inserted] = core_->findOrInsert(*state, key, promise);
+    if (!inserted) {
+      node->second.promise = std::move(promise);
+    }
+    core_->setWeight(*state, *node, weight);
+    core_->evictToFit(*state, node);
   }
 
   void erase(const KEY& key) {
-    std::lock_guard<std::mutex> g(lock_);
-    cache_.erase(key);
+    auto state = core_->shardFor(key).state.wlock();
+    auto it = state->map.find(key);
+    if (it != state->map.end()) {
+      core_->remove(*state, *it);
+    }
   }
 
   void setMaxSize(size_t size) {
-    cache_.setMaxSize(size);
+    core_->setMaxSize(size);
+  }
+
+  void setMaxWeight(size_t weight) {
+    core_->setMaxWeight(weight);
   }
 
   FutureType get(const KEY& key) {
-    SharedPromiseType entry;
+    bool isNew = false;
+    auto entry = lookup(key, isNew);
+    auto future = entry->getFuture();
 
-    {
-      std::lock_guard<std::mutex> g(lock_);
+    if (isNew) {
+      std::vector<Miss> misses;
+      misses.push_back(Miss{key, std::move(entry)});
+      fetch(core_, std::move(misses), /*flush=*/false);
+    }
 
-      auto it = cache_.find(key);
-      if (it != cache_.end()) {
-        entry = it->second;
-        return entry->getFuture();
+    return future;
+  }
+
+  /**
+   * Look up every key in keys, returning one future per key, in the same
+   * order. The misses are fetched together, in batches of at most
+   * maxBatchSize keys, without waiting for the batch window.
+   */
+  std::vector<FutureType> getBatch(const std::vector<KEY>& keys) {
+    std::vector<FutureType> futures;
+    futures.reserve(keys.size());
+    std::vector<Miss> misses;
+
+    for (const auto& key : keys) {
+      bool isNew = false;
+      auto entry = lookup(key, isNew);
+      futures.push_back(entry->getFuture());
+      if (isNew) {
+        misses.push_back(Miss{key, std::move(entry)});
       }
+    }
 
-      entry = std::make_shared<typename SharedPromiseType::element_type>();
-      cache_.set(key, entry);
+    fetch(core_, std::move(misses), /*flush=*/true);
+    return futures;
+  }
+
+  bool exists(const KEY& key) {
+    return core_->shardFor(key).state.rlock()->map.contains(key);
+  }
+
+  /**
+   * The number of cached entries, including those still being fetched.
+   */
+  size_t size() const {
+    return core_->size();
+  }
+
+  /**
+   * The total weight of the cached values.
+   */
+  size_t weight() const {
+    return core_->weight();
+  }
+
+ private:
+  static Options
+  makeOptions(size_t maxSize, size_t clearSize, size_t numShards) {
+    Options options;
+    options.maxSize = maxSize;
+    options.clearSize = clearSize;
+    options.numShards = numShards;
+    return options;
+  }
+
+  /**
+   * Return the entry for key, inserting one, which the caller must fetch, if
+   * there is none.
+   */
+  SharedPromiseType lookup(const KEY& key, bool& isNew) {
+    auto& core = *core_;
+    return tryRlockCheckBeforeUpdate<SharedPromiseType>(
+        core.shardFor(key).state,
+        [&](const State& state) -> std::optional<SharedPromiseType> {
+          auto it = state.map.find(key);
+          if (it == state.map.end()) {
+            return std::nullopt;
+          }
+          core.hit(it->second);
+          return it->second.promise;
+        },
+        [&](auto& state) {
+          auto promise =
+              std::make_shared<typename SharedPromiseType::element_type>();
+          auto [node, inserted] = core.findOrInsert(*state, key, promise);
+          core.evictToFit(*state, node);
+          core.miss();
+          isNew = true;
+          return promise;
+        });
+  }
+
+  static void fetch(
+      const std::shared_ptr<Core>& core,
+      std::vector<Miss> misses,
+      bool flush) {
+    if (misses.empty()) {
+      return;
+    }
+    if (core->batchFetcher) {
+      batch(core, std::move(misses), flush);
+      return;
     }
+    for (auto& miss : misses) {
+      // A fetcher that throws fails its key, not the whole batch of misses.
+      folly::makeFutureWith([&] { return core->fetcher(miss.key); })
+          .thenTry([weakCore = std::weak_ptr<Core>{core},
+                    key = std::move(miss.key),
+                    promise = std::move(miss.promise)](
+                       folly::Try<ValuePtr>&& t) {
+            complete(weakCore, key, promise, std::move(t));
+          });
+    }
+  }
 
-    auto future = entry->getFuture();
+  /**
+   * Add misses to the batch being collected, and fetch it once it is full,
+   * or right away if flush is set or there is no batch window. Otherwise, arm
+   * a timer to fetch it when the window elapses.
+   */
+  static void batch(
+      const std::shared_ptr<Core>& core,
+      std::vector<Miss> misses,
+      bool flush) {
+    std::vector<std::vector<Miss>> ready;
+    std::optional<uint64_t> timerGeneration;
+    {
+      auto batcher = core->batcher.lock();
+      for (auto& miss : misses) {
+        batcher->misses.push_back(std::move(miss));
+        if (batcher->misses.size() >= core->maxBatchSize) {
+          ready.push_back(takeBatch(*batcher));
+        }
+      }
+      if (!batcher->misses.empty()) {
+        if (flush || core->batchWindow.count() <= 0) {
+          ready.push_back(takeBatch(*batcher));
+        } else if (!batcher->timerArmed) {
+          batcher->timerArmed = true;
+          timerGeneration = batcher->generation;
+        }
+      }
+    }
 
-    fetcher_(key).thenTry(
-        [entry](folly::Try<ValuePtr>&& t) { entry->setTry(std::move(t)); });
+    for (auto& full : ready) {
+      fetchBatch(core, std::move(full));
+    }
 
-    return future;
+    if (timerGeneration) {
+      // Fetch the batch even if the timer fails, e.g. when the Timekeeper is
+      // shutting down: its misses would otherwise never complete, and no
+      // later miss would arm the timer again.
+      folly::futures::sleep(core->batchWindow, core->timekeeper)
+          .via(
+              core->executor ? core->executor.copy()
+                             : folly::getGlobalCPUExecutor())
+          .thenTry([weakCore = std::weak_ptr<Core>{core},
+                    generation = *timerGeneration](folly::Try<folly::Unit>&&) {
+            auto core = weakCore.lock();
+            if (!core) {
+              return;
+            }
+            std::vector<Miss> pending;
+            {
+              auto batcher = core->batcher.lock();
+              if (batcher->generation != generation) {
+                // Fetched when it filled up.
+                return;
+              }
+              pending = takeBatch(*batcher);
+            }
+            fetchBatch(core, std::move(pending));
+          });
+    }
   }
 
-  bool exists(const KEY& key) {
-    return cache_.exists(key);
+  static std::vector<Miss> takeBatch(Batcher& batcher) {
+    ++batcher.generation;
+    batcher.timerArmed = false;
+    return std::exchange(batcher.misses, {});
+  }
+
+  static void fetchBatch(
+      const std::shared_ptr<Core>& core,
+      std::vector<Miss> misses) {
+    std::vector<KEY> keys;
+    keys.reserve(misses.size());
+    for (const auto& miss : misses) {
+      keys.push_back(miss.key);
+    }
+
+    using Results = std::vector<folly::Try<ValuePtr>>;
+    folly::makeFutureWith([&] { return core->batchFetcher(std::move(keys)); })
+        .thenTry([weakCore = std::weak_ptr<Core>{core},
+                  misses = std::move(misses)](folly::Try<Results>&& results) {
+          if (results.hasValue() && results->size() != misses.size()) {
+            results = folly::Try<Results>{
+                folly::make_exception_wrapper<std::length_error>(
+                    "batch fetcher returned the wrong number of values")};
+          }
+          for (size_t i = 0; i < misses.size(); ++i) {
+            auto result = results.hasException()
+                ? folly::Try<ValuePtr>{results.exception()}
+                : std::move((*results)[i]);
+            complete(
+                weakCore, misses[i].key, misses[i].promise, std::move(result));
+          }
+        });
+  }
+
+  /**
+   * Record the result of the fetch of key, and hand it to its waiters.
+   */
+  static void complete(
+      const std::weak_ptr<Core>& weakCore,
+      const KEY& key,
+      const SharedPromiseType& promise,
+      folly::Try<ValuePtr>&& t) {
+    if (auto core = weakCore.lock(); core && core->weigher) {
+      if (t.hasValue() && t.value()) {
+        weigh(*core, key, promise, core->weigher(key, *t.value()));
+      }
+    }
+    promise->setTry(std::move(t));
+  }
+
+  /**
+   * Record the weight of a fetched value, unless its entry was evicted or
+   * replaced in the meantime.
+   */
+  static void weigh(
+      Core& core,
+      const KEY& key,
+      const SharedPromiseType& promise,
+      size_t weight) {
+    auto state = core.shardFor(key).state.wlock();
+    auto it = state->map.find(key);
+    if (it == state->map.end() || it->second.promise != promise) {
+      return;
+    }
+    core.setWeight(*state, *it, weight);
+    core.evictToFit(*state, &*it);
   }
 };
 
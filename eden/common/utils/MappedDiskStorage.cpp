@@ -0,0 +1,757 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/MappedDiskStorage.h"
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/hash/Checksum.h>
+#include <folly/logging/xlog.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/SysStat.h>
+#include <folly/portability/Unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+
+#include <sys/mman.h>
+
+namespace facebook::eden {
+
+namespace {
+
+/**
+ * msync() requires a page aligned address, and the system page size may be
+ * larger than kPageSize.
+ */
+size_t systemPageSize() {
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  return pageSize;
+}
+
+void lockFile(const folly::File& file, folly::StringPiece path) {
+#ifdef F_OFD_SETLK
+  // Writers share the flock with read-only openers, and exclude each other
+  // with an exclusive lock on the open file description, which is
+  // independent of flock and, like it, follows the file through renames.
+  if (!file.try_lock_shared()) {
+    folly::throwSystemError("failed to acquire lock on ", path);
+  }
+  struct flock lock {};
+  lock.l_type = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  if (-1 == fcntl(file.fd(), F_OFD_SETLK, &lock)) {
+    folly::throwSystemError("failed to acquire lock on ", path);
+  }
+#else
+  if (!file.try_lock()) {
+    folly::throwSystemError("failed to acquire lock on ", path);
+  }
+#endif
+}
+
+MappedDiskStorage::Header readHeader(const folly::File& file) {
+  MappedDiskStorage::Header header;
+  ssize_t readBytes = folly::preadNoInt(file.fd(), &header, sizeof(header), 0);
+  if (readBytes == -1) {
+    folly::throwSystemError("failed to read MappedDiskVector header");
+  } else if (readBytes != sizeof(header)) {
+    XLOGF(
+        WARNING,
+        "file contains incomplete header: only read {} bytes",
+        readBytes);
+    throw std::runtime_error("Incomplete MappedDiskVector header");
+  }
+  return header;
+}
+
+/**
+ * The checks that don't depend on the record count, which may be ahead of
+ * the file after a crash.
+ */
+void validateHeader(const MappedDiskStorage::Header& header, off_t fileSize) {
+  if (MappedDiskStorage::kMagic != header.magic || header.version != 1 ||
+      static_cast<off_t>(sizeof(header)) > fileSize ||
+      header.recordSize == 0 ||
+      (header.flags &
+       ~(MappedDiskStorage::kHeaderChecksum |
+         MappedDiskStorage::kRecordChecksums)) != 0 ||
+      (!(header.flags & MappedDiskStorage::kHeaderChecksum) &&
+       header.checksum != 0)) {
+    throw std::runtime_error(
+        "Invalid header: this is probably not a MappedDiskVector file");
+  }
+}
+
+/**
+ * The format of the record checksum file: one CRC32C per block.
+ */
+constexpr MappedDiskStorage::RecordFormat kChecksumFormat{1, sizeof(uint32_t)};
+
+} // namespace
+
+std::string MappedDiskStorage::checksumPath(folly::StringPiece path) {
+  return folly::to<std::string>(path, ".crc");
+}
+
+MappedDiskStorage MappedDiskStorage::open(
+    folly::StringPiece path,
+    RecordFormat formatIfNew,
+    const MappedDiskOptions& options) {
+  folly::File file{path, O_RDWR | O_CREAT | O_CLOEXEC, 0600};
+  lockFile(file, path);
+
+  struct stat st;
+  folly::checkUnixError(
+      fstat(file.fd(), &st), "fstat failed on MappedDiskVector path ", path);
+
+  if (st.st_size == 0) {
+    auto storage = initializeFromScratch(std::move(file), formatIfNew, options);
+    storage.attachChecksums(path, /*isNew=*/true);
+    return storage;
+  }
+
+  auto header = readHeader(file);
+  validateHeader(header, st.st_size);
+
+  // After a crash, the header may have reached the disk ahead of the
+  // records it counts, or not at all.
+  bool consistent = true;
+  if ((header.flags & kHeaderChecksum) &&
+      header.checksum != computeHeaderChecksum(header)) {
+    if (!options.recover) {
+      throw std::runtime_error("MappedDiskVector header checksum mismatch");
+    }
+    XLOG(WARNING, "MappedDiskVector header checksum mismatch, recovering");
+    consistent = false;
+  }
+  // careful not to overflow by multiplying entryCount by recordSize
+  uint64_t maxEntryCount = (st.st_size - sizeof(header)) / header.recordSize;
+  if (header.entryCount > maxEntryCount) {
+    if (!options.recover) {
+      throw std::runtime_error(
+          "Invalid header: this is probably not a MappedDiskVector file");
+    }
+    XLOGF(
+        WARNING,
+        "MappedDiskVector header counts {} records but the file only fits {}",
+        header.entryCount,
+        maxEntryCount);
+    consistent = false;
+  }
+
+  MappedDiskStorage storage{
+      std::move(file),
+      static_cast<size_t>(st.st_size),
+      options,
+      /*readOnly=*/false};
+  if (!consistent) {
+    storage.setEntryCount(std::min(storage.entryCount(), maxEntryCount));
+  }
+  storage.attachChecksums(path, /*isNew=*/false);
+  return storage;
+}
+
+MappedDiskStorage MappedDiskStorage::openReadOnly(
+    folly::StringPiece path,
+    const MappedDiskOptions& options) {
+  folly::File file{path, O_RDONLY | O_CLOEXEC};
+  if (!file.try_lock_shared()) {
+    folly::throwSystemError("failed to acquire shared lock on ", path);
+  }
+
+  struct stat st;
+  folly::checkUnixError(
+      fstat(file.fd(), &st), "fstat failed on MappedDiskVector path ", path);
+  validateHeader(readHeader(file), st.st_size);
+
+  MappedDiskStorage storage{
+      std::move(file),
+      static_cast<size_t>(st.st_size),
+      options,
+      /*readOnly=*/true};
+  storage.refresh();
+  return storage;
+}
+
+MappedDiskStorage MappedDiskStorage::createOrOverwrite(
+    folly::StringPiece path,
+    RecordFormat format,
+    const MappedDiskOptions& options) {
+  folly::File file{
+      path, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600};
+  lockFile(file, path);
+  auto storage = initializeFromScratch(std::move(file), format, options);
+  storage.attachChecksums(path, /*isNew=*/true);
+  return storage;
+}
+
+MappedDiskStorage MappedDiskStorage::initializeFromScratch(
+    folly::File file,
+    RecordFormat format,
+    const MappedDiskOptions& options) {
+  // Start the file large enough to handle the header and a little under one
+  // round one of growth.
+  if (-1 == folly::ftruncateNoInt(file.fd(), kInitialSizeInBytes)) {
+    folly::throwSystemError(
+        "failed to initialize MappedDiskVector: ftruncate() failed");
+  }
+
+  Header header;
+  header.magic = kMagic;
+  header.version = 1;
+  header.recordVersion = format.version;
+  header.recordSize = format.size;
+  header.entryCount = 0;
+  header.flags = 0;
+  header.checksum = 0;
+  ssize_t written = folly::pwriteNoInt(file.fd(), &header, sizeof(header), 0);
+  if (-1 == written) {
+    folly::throwSystemError("Failed to write initial header");
+  }
+  if (written != sizeof(header)) {
+    throw std::runtime_error("Failed to write complete initial header");
+  }
+
+  // There is nothing to populate in a new file.
+  auto newOptions = options;
+  newOptions.populate = false;
+  return MappedDiskStorage{
+      std::move(file), kInitialSizeInBytes, newOptions, /*readOnly=*/false};
+}
+
+MappedDiskStorage::MappedDiskStorage(
+    folly::File file,
+    size_t fileSize,
+    const MappedDiskOptions& options,
+    bool readOnly)
+    : file_(std::move(file)), options_(options), readOnly_(readOnly) {
+  // It's worth keeping the file and mapping a whole number of pages to
+  // avoid wasting an partial page at the end.  Note that this is an
+  // optimization and it doesn't matter if kPageSize differs from the
+  // system page size.
+  size_t desiredSize = detail::roundUpToNonzeroPageSize(fileSize);
+  if (fileSize != desiredSize && !readOnly_) {
+    if (fileSize) {
+      XLOGF(
+          WARNING,
+          "Warning: MappedDiskVector file size not multiple of page size: {}",
+          fileSize);
+    }
+    if (folly::ftruncateNoInt(file_.fd(), desiredSize)) {
+      folly::throwSystemError(
+          "ftruncateNoInt failed when rounding up to page size");
+    }
+  }
+
+  auto map = mmap(
+      nullptr,
+      desiredSize,
+      protection(),
+      MAP_SHARED
+#ifdef MAP_POPULATE
+          | (options_.populate ? MAP_POPULATE : 0)
+#endif
+          ,
+      file_.fd(),
+      0);
+  if (map == MAP_FAILED) {
+    folly::throwSystemError("mmap failed on file open");
+  }
+
+  map_ = map;
+  mapSizeInBytes_ = desiredSize;
+  reservedSizeInBytes_ = desiredSize;
+
+  applyAdvice();
+#ifdef MADV_WILLNEED
+  if (options_.willNeed && madvise(map_, mapSizeInBytes_, MADV_WILLNEED)) {
+    XLOGF(DBG3, "madvise(MADV_WILLNEED) failed: {}", folly::errnoStr(errno));
+  }
+#endif
+  lockPrefix();
+}
+
+MappedDiskStorage::MappedDiskStorage(MappedDiskStorage&& other) noexcept
+    : map_{std::exchange(other.map_, nullptr)},
+      mapSizeInBytes_{std::exchange(other.mapSizeInBytes_, 0)},
+      reservedSizeInBytes_{std::exchange(other.reservedSizeInBytes_, 0)},
+      file_{std::move(other.file_)},
+      options_{other.options_},
+      lockedSizeInBytes_{std::exchange(other.lockedSizeInBytes_, 0)},
+      readOnly_{other.readOnly_},
+      readOnlyEntryCount_{other.readOnlyEntryCount_},
+      durability_{other.durability_},
+      headerDirty_{std::exchange(other.headerDirty_, false)},
+      dirty_{std::move(other.dirty_)},
+      recordChecksums_{std::move(other.recordChecksums_)},
+      staleChecksums_{std::move(other.staleChecksums_)} {
+  other.dirty_.clear();
+  other.staleChecksums_.clear();
+}
+
+MappedDiskStorage& MappedDiskStorage::operator=(
+    MappedDiskStorage&& other) noexcept {
+  if (this != &other) {
+    if (map_) {
+      close();
+      munmap(map_, reservedSizeInBytes_);
+    }
+    map_ = std::exchange(other.map_, nullptr);
+    mapSizeInBytes_ = std::exchange(other.mapSizeInBytes_, 0);
+    reservedSizeInBytes_ = std::exchange(other.reservedSizeInBytes_, 0);
+    file_ = std::move(other.file_);
+    options_ = other.options_;
+    lockedSizeInBytes_ = std::exchange(other.lockedSizeInBytes_, 0);
+    readOnly_ = other.readOnly_;
+    readOnlyEntryCount_ = other.readOnlyEntryCount_;
+    durability_ = other.durability_;
+    headerDirty_ = std::exchange(other.headerDirty_, false);
+    dirty_ = std::move(other.dirty_);
+    other.dirty_.clear();
+    recordChecksums_ = std::move(other.recordChecksums_);
+    staleChecksums_ = std::move(other.staleChecksums_);
+    other.staleChecksums_.clear();
+  }
+  return *this;
+}
+
+MappedDiskStorage::~MappedDiskStorage() {
+  if (map_) {
+    close();
+    munmap(map_, reservedSizeInBytes_);
+  }
+}
+
+void MappedDiskStorage::close() noexcept {
+  if (!recordChecksums_) {
+    return;
+  }
+  try {
+    updateRecordChecksums();
+  } catch (const std::exception& ex) {
+    XLOGF(
+        ERR,
+        "failed to update MappedDiskVector checksums on close: {}",
+        ex.what());
+  }
+}
+
+int MappedDiskStorage::protection() const {
+  return readOnly_ ? PROT_READ : PROT_READ | PROT_WRITE;
+}
+
+uint64_t MappedDiskStorage::refresh() {
+  XCHECK(readOnly_) << "only read-only MappedDiskStorage needs refreshing";
+
+  // The writer updates the header in place, so it may be caught halfway
+  // through an update. Retry until it is consistent.
+  Header header;
+  for (int attempt = 0;; ++attempt) {
+    std::memcpy(&header, map_, sizeof(header));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!(header.flags & kHeaderChecksum) ||
+        header.checksum == computeHeaderChecksum(header)) {
+      break;
+    }
+    if (attempt == kMaxRefreshAttempts) {
+      throw std::runtime_error("MappedDiskVector header checksum mismatch");
+    }
+    std::this_thread::yield();
+  }
+
+  // Map whatever the file grew by. Only the header of the mapping is read
+  // before its size is known, so this never touches pages past the end.
+  struct stat st;
+  folly::checkUnixError(
+      fstat(file_.fd(), &st), "fstat failed on MappedDiskVector");
+  size_t fileSize = static_cast<size_t>(st.st_size);
+  size_t newSizeInBytes = detail::roundUpToNonzeroPageSize(fileSize);
+  if (newSizeInBytes > reservedSizeInBytes_) {
+    remap(newSizeInBytes);
+  }
+  mapSizeInBytes_ = std::max(mapSizeInBytes_, newSizeInBytes);
+
+  uint64_t maxEntryCount = fileSize < sizeof(Header)
+      ? 0
+      : (fileSize - sizeof(Header)) / header.recordSize;
+  readOnlyEntryCount_ = std::min(header.entryCount, maxEntryCount);
+  return readOnlyEntryCount_;
+}
+
+void MappedDiskStorage::resize(size_t newSizeInBytes) {
+  XCHECK(!readOnly_) << "cannot resize a read-only MappedDiskStorage";
+  // Always keep the file size a whole number of pages.
+  XCHECK_EQ(0ul, newSizeInBytes % detail::kPageSize);
+  XCHECK_GE(newSizeInBytes, sizeof(Header));
+
+  if (-1 == folly::ftruncateNoInt(file_.fd(), newSizeInBytes)) {
+    folly::throwSystemError("ftruncateNoInt failed when growing capacity");
+  }
+
+  if (newSizeInBytes > reservedSizeInBytes_) {
+    remap(newSizeInBytes);
+  }
+  mapSizeInBytes_ = newSizeInBytes;
+  lockPrefix();
+}
+
+void MappedDiskStorage::grow(size_t minimumSizeInBytes) {
+  minimumSizeInBytes = detail::roundUpToNonzeroPageSize(minimumSizeInBytes);
+  size_t newSizeInBytes = detail::roundUpToNonzeroPageSize(std::max(
+      {minimumSizeInBytes,
+       mapSizeInBytes_ + kMinimumGrowthInBytes,
+       mapSizeInBytes_ + mapSizeInBytes_ / 2}));
+  // Don't let the growth policy alone push the file past the reserved address
+  // space: that would move the mapping.
+  if (minimumSizeInBytes <= reservedSizeInBytes_) {
+    newSizeInBytes = std::min(newSizeInBytes, reservedSizeInBytes_);
+  }
+  resize(newSizeInBytes);
+}
+
+void MappedDiskStorage::reserveAddressSpace(size_t sizeInBytes) {
+  sizeInBytes = detail::roundUpToNonzeroPageSize(sizeInBytes);
+  if (sizeInBytes > reservedSizeInBytes_) {
+    remap(sizeInBytes);
+  }
+}
+
+void MappedDiskStorage::remap(size_t newMappingSize) {
+  // mremap() requires the old range to be a single mapping, and locking part
+  // of it splits it.
+  unlockPrefix();
+
+#ifdef __APPLE__
+  auto newMap = mmap(
+      nullptr,
+      newMappingSize,
+      protection(),
+      MAP_SHARED,
+      file_.fd(),
+      0);
+#else
+  auto newMap =
+      mremap(map_, reservedSizeInBytes_, newMappingSize, MREMAP_MAYMOVE);
+#endif
+  if (newMap == MAP_FAILED) {
+    folly::throwSystemError(
+        folly::to<std::string>(
+            "mremap failed when growing capacity from ",
+            reservedSizeInBytes_,
+            " to ",
+            newMappingSize));
+  }
+
+#ifdef __APPLE__
+  munmap(map_, reservedSizeInBytes_);
+#endif
+  map_ = newMap;
+  reservedSizeInBytes_ = newMappingSize;
+
+  applyAdvice();
+  // resize() locks the prefix once the new size is known.
+}
+
+void MappedDiskStorage::setAccessPattern(
+    MappedDiskAccessPattern accessPattern) {
+  options_.accessPattern = accessPattern;
+  applyAdvice();
+}
+
+void MappedDiskStorage::applyAdvice() {
+  auto advise = [&](int advice, folly::StringPiece name) {
+    if (madvise(map_, reservedSizeInBytes_, advice)) {
+      XLOGF(DBG3, "madvise({}) failed: {}", name, folly::errnoStr(errno));
+    }
+  };
+
+  switch (options_.accessPattern) {
+    case MappedDiskAccessPattern::Normal:
+      advise(MADV_NORMAL, "MADV_NORMAL");
+      break;
+    case MappedDiskAccessPattern::Sequential:
+      advise(MADV_SEQUENTIAL, "MADV_SEQUENTIAL");
+      break;
+    case MappedDiskAccessPattern::Random:
+      advise(MADV_RANDOM, "MADV_RANDOM");
+      break;
+  }
+#ifdef MADV_HUGEPAGE
+  if (options_.hugePages) {
+    advise(MADV_HUGEPAGE, "MADV_HUGEPAGE");
+  }
+#endif
+}
+
+void MappedDiskStorage::lockPrefix() {
+  if (!options_.lockHeader) {
+    return;
+  }
+  size_t target = std::min(
+      mapSizeInBytes_,
+      detail::roundUpToNonzeroPageSize(
+          sizeof(Header) +
+          std::min(options_.lockedPrefixInBytes, mapSizeInBytes_)));
+  if (target <= lockedSizeInBytes_) {
+    return;
+  }
+  if (mlock(map_, target)) {
+    // Most likely RLIMIT_MEMLOCK. Keep whatever was locked before.
+    XLOGF(
+        WARNING,
+        "mlock of {} bytes of MappedDiskVector failed: {}",
+        target,
+        folly::errnoStr(errno));
+    return;
+  }
+  lockedSizeInBytes_ = target;
+}
+
+void MappedDiskStorage::unlockPrefix() {
+  if (lockedSizeInBytes_) {
+    munlock(map_, lockedSizeInBytes_);
+    lockedSizeInBytes_ = 0;
+  }
+}
+
+uint32_t MappedDiskStorage::computeHeaderChecksum(const Header& header) {
+  return folly::crc32c(
+      reinterpret_cast<const uint8_t*>(&header), offsetof(Header, checksum));
+}
+
+void MappedDiskStorage::updateHeaderChecksum() {
+  header().checksum = computeHeaderChecksum(header());
+}
+
+void MappedDiskStorage::attachChecksums(folly::StringPiece path, bool isNew) {
+  uint32_t flags = header().flags;
+  if (options_.checksumHeader) {
+    flags |= kHeaderChecksum;
+  }
+  if (options_.checksumRecords) {
+    flags |= kRecordChecksums;
+  }
+
+  if (flags & kRecordChecksums) {
+    auto crcPath = checksumPath(path);
+    bool verify = !isNew && (header().flags & kRecordChecksums);
+    struct stat st;
+    if (verify && ::stat(crcPath.c_str(), &st) != 0) {
+      XLOGF(
+          WARNING,
+          "MappedDiskVector checksums missing at {}, recomputing them",
+          crcPath);
+      verify = false;
+    }
+    if (verify) {
+      try {
+        recordChecksums_ = std::make_unique<MappedDiskStorage>(
+            open(crcPath, kChecksumFormat));
+        if (recordChecksums_->recordSize() != kChecksumFormat.size ||
+            recordChecksums_->recordVersion() != kChecksumFormat.version) {
+          throw std::runtime_error("unexpected checksum record format");
+        }
+      } catch (const std::exception& ex) {
+        XLOGF(
+            WARNING,
+            "unable to open MappedDiskVector checksums at {}, "
+            "recomputing them: {}",
+            crcPath,
+            ex.what());
+        recordChecksums_.reset();
+        verify = false;
+      }
+    }
+    if (!recordChecksums_) {
+      recordChecksums_ = std::make_unique<MappedDiskStorage>(
+          createOrOverwrite(crcPath, kChecksumFormat));
+    }
+    recordChecksums_->setDurability(durability_);
+
+    if (verify && options_.recover) {
+      auto verified = verifiedEntryCount();
+      if (verified != entryCount()) {
+        XLOGF(
+            WARNING,
+            "truncating MappedDiskVector from {} to {} verified records",
+            entryCount(),
+            verified);
+        setEntryCount(verified);
+      }
+    }
+    if (!verify) {
+      // Nothing to compare against: checksum what is there.
+      staleChecksums_.add(
+          sizeof(Header), sizeof(Header) + entryCount() * recordSize());
+    }
+  }
+
+  if (flags != header().flags) {
+    header().flags = flags;
+    header().checksum = 0;
+  }
+  if (flags & kHeaderChecksum) {
+    updateHeaderChecksum();
+  }
+}
+
+size_t MappedDiskStorage::recordsPerChecksumBlock() const {
+  return std::max<size_t>(1, kChecksumBlockSizeInBytes / recordSize());
+}
+
+uint64_t MappedDiskStorage::verifiedEntryCount() const {
+  const auto* checksums =
+      static_cast<const uint32_t*>(recordChecksums_->records());
+  const auto* bytes = static_cast<const uint8_t*>(records());
+  size_t size = recordSize();
+  size_t perBlock = recordsPerChecksumBlock();
+  uint64_t count = entryCount();
+
+  // A single sequential pass: CRC32C is computed with hardware instructions
+  // where available, so this runs at close to memory bandwidth.
+  for (uint64_t block = 0; block * perBlock < count; ++block) {
+    uint64_t first = block * perBlock;
+    uint64_t last = std::min<uint64_t>(first + perBlock, count);
+    if (block >= recordChecksums_->entryCount()) {
+      return first;
+    }
+    uint32_t expected = checksums[block];
+    if (folly::crc32c(bytes + first * size, (last - first) * size) ==
+        expected) {
+      continue;
+    }
+
+    // The checksum of the last block covers the records it held at the last
+    // flush. Find the longest prefix of the block that matches it.
+    uint64_t verified = first;
+    uint32_t crc = ~0U;
+    for (uint64_t i = first; i < last; ++i) {
+      crc = folly::crc32c(bytes + i * size, size, crc);
+      if (crc == expected) {
+        verified = i + 1;
+      }
+    }
+    return verified;
+  }
+  return count;
+}
+
+void MappedDiskStorage::updateRecordChecksums() {
+  size_t size = recordSize();
+  size_t perBlock = recordsPerChecksumBlock();
+  size_t blockSizeInBytes = perBlock * size;
+  uint64_t count = entryCount();
+  uint64_t blockCount = (count + perBlock - 1) / perBlock;
+
+  size_t neededInBytes = sizeof(Header) + blockCount * sizeof(uint32_t);
+  if (neededInBytes > recordChecksums_->sizeInBytes()) {
+    recordChecksums_->grow(neededInBytes);
+  }
+  auto* checksums = static_cast<uint32_t*>(recordChecksums_->records());
+  const auto* bytes = static_cast<const uint8_t*>(records());
+
+  auto update = [&](uint64_t block) {
+    uint64_t first = block * perBlock;
+    uint64_t last = std::min<uint64_t>(first + perBlock, count);
+    checksums[block] =
+        folly::crc32c(bytes + first * size, (last - first) * size);
+    recordChecksums_->markDirty(
+        sizeof(Header) + block * sizeof(uint32_t), sizeof(uint32_t));
+  };
+
+  uint64_t lastUpdated = blockCount;
+  staleChecksums_.forEachInterval([&](size_t begin, size_t end) {
+    uint64_t firstBlock = (begin - sizeof(Header)) / blockSizeInBytes;
+    uint64_t endBlock = std::min<uint64_t>(
+        (end - sizeof(Header) + blockSizeInBytes - 1) / blockSizeInBytes,
+        blockCount);
+    for (uint64_t block = firstBlock; block < endBlock; ++block) {
+      update(block);
+      lastUpdated = block;
+    }
+  });
+  staleChecksums_.clear();
+  // Records may have been removed from the last block without modifying it.
+  if (blockCount > 0 && lastUpdated != blockCount - 1) {
+    update(blockCount - 1);
+  }
+  recordChecksums_->setEntryCount(blockCount);
+}
+
+void MappedDiskStorage::setDurability(MappedDiskDurability durability) {
+  XCHECK(!readOnly_ || durability == MappedDiskDurability::None)
+      << "a read-only MappedDiskStorage has nothing to flush";
+  if (durability_ == MappedDiskDurability::None &&
+      durability != MappedDiskDurability::None) {
+    dirty_.add(sizeof(Header), mapSizeInBytes_);
+    headerDirty_ = true;
+  } else if (durability == MappedDiskDurability::None) {
+    dirty_.clear();
+    headerDirty_ = false;
+  }
+  durability_ = durability;
+  if (recordChecksums_) {
+    recordChecksums_->setDurability(durability);
+  }
+}
+
+void MappedDiskStorage::flush() {
+  if (recordChecksums_) {
+    updateRecordChecksums();
+  }
+  if (durability_ == MappedDiskDurability::None) {
+    return;
+  }
+
+  int flags =
+      durability_ == MappedDiskDurability::Strict ? MS_SYNC : MS_ASYNC;
+  // msync() writes whole pages, and the first one holds the header: leave it
+  // for last, so that in strict mode, the header is only written once the
+  // records it counts and their checksums are on disk.
+  const size_t firstPageEnd = systemPageSize();
+  bool firstPageDirty = headerDirty_;
+  dirty_.forEachInterval([&](size_t begin, size_t end) {
+    if (begin < firstPageEnd) {
+      firstPageDirty = true;
+      begin = firstPageEnd;
+    }
+    syncRange(begin, end, flags);
+  });
+  dirty_.clear();
+  if (recordChecksums_) {
+    recordChecksums_->flush();
+  }
+
+  if (firstPageDirty) {
+    syncRange(0, firstPageEnd, flags);
+    headerDirty_ = false;
+  }
+}
+
+void MappedDiskStorage::syncRange(size_t begin, size_t end, int flags) {
+  begin -= begin % systemPageSize();
+  end = std::min(end, mapSizeInBytes_);
+  if (begin >= end) {
+    return;
+  }
+  if (msync(static_cast<char*>(map_) + begin, end - begin, flags)) {
+    folly::throwSystemError(
+        "msync failed on MappedDiskVector range ", begin, "-", end);
+  }
+}
+
+} // namespace facebook::eden
+
+#endif
@@ -0,0 +1,501 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "eden/common/utils/CoverageSet.h"
+
+namespace facebook::eden {
+
+namespace detail {
+
+/**
+ * The precise value of kPageSize doesn't matter for correctness.  It's used
+ * primarily as a microoptimization - MappedDiskStorage attempts to avoid
+ * mapping fractions of pages which lets it resize the file a bit less often.
+ */
+constexpr size_t kPageSize = 4096;
+
+inline size_t roundUpToNonzeroPageSize(size_t s) {
+  static_assert(
+      0 == (kPageSize & (kPageSize - 1)), "kPageSize must be power of two");
+  return std::max(kPageSize, (s + kPageSize - 1) & ~(kPageSize - 1));
+}
+
+} // namespace detail
+
+/**
+ * How hard MappedDiskStorage works to get modifications onto the disk.
+ */
+enum class MappedDiskDurability {
+  /**
+   * Leave writeback entirely to the kernel. flush() does nothing and no
+   * bookkeeping is done on writes.
+   */
+  None,
+  /**
+   * Track the pages that were modified. flush() schedules their writeback
+   * with msync(MS_ASYNC) and returns without waiting for it.
+   */
+  Async,
+  /**
+   * Track the pages that were modified. flush() writes them with
+   * msync(MS_SYNC), and only then writes the header, so that once it returns
+   * the header never counts records that are not on disk yet.
+   */
+  Strict,
+};
+
+/**
+ * The expected access pattern for a mapping, passed to madvise().
+ */
+enum class MappedDiskAccessPattern {
+  /// MADV_NORMAL: the kernel's default readahead.
+  Normal,
+  /// MADV_SEQUENTIAL: aggressive readahead, for full scans.
+  Sequential,
+  /// MADV_RANDOM: no readahead, for point lookups.
+  Random,
+};
+
+/**
+ * How MappedDiskStorage maps its file. The defaults leave everything to the
+ * kernel. All of these are hints: failures to apply them are logged and
+ * otherwise ignored, and platforms without the underlying call skip them.
+ */
+struct MappedDiskOptions {
+  /**
+   * Map with MAP_POPULATE, faulting in the whole file before open returns.
+   */
+  bool populate{false};
+
+  /**
+   * Start reading the whole file in the background with MADV_WILLNEED.
+   * Unlike populate, open does not wait for it.
+   */
+  bool willNeed{false};
+
+  /**
+   * Ask for transparent huge pages with MADV_HUGEPAGE, which reduces TLB
+   * misses on large files when the filesystem supports them.
+   */
+  bool hugePages{false};
+
+  MappedDiskAccessPattern accessPattern{MappedDiskAccessPattern::Normal};
+
+  /**
+   * Keep the header resident with mlock(), along with the first
+   * lockedPrefixInBytes bytes of records, which are typically the hottest.
+   * As the file grows, more of it is locked up to that limit. Subject to
+   * RLIMIT_MEMLOCK.
+   */
+  bool lockHeader{false};
+  size_t lockedPrefixInBytes{0};
+
+  /**
+   * Protect the header with a CRC32C. Files written without it are upgraded
+   * when opened with this set. Older versions of this code refuse to open
+   * files with a checksummed header, so it is off by default.
+   */
+  bool checksumHeader{false};
+
+  /**
+   * Also keep a CRC32C of every block of records, in a "<path>.crc" file
+   * next to the main file. The checksums are brought up to date by flush()
+   * and when the file is closed, so after a crash, the records appended or
+   * modified since the last flush are the ones that fail to verify.
+   */
+  bool checksumRecords{false};
+
+  /**
+   * When the header's record count is inconsistent with the file, or its
+   * checksum does not match, truncate the records to the last one that can
+   * be verified instead of throwing. With checksumRecords, every record is
+   * verified in a single sequential pass.
+   */
+  bool recover{false};
+};
+
+/**
+ * The untyped core of MappedDiskVector: a file made of a fixed size header
+ * followed by an array of fixed size records, memory-mapped in its entirety.
+ *
+ * MappedDiskStorage owns the file descriptor and the mapping. It creates and
+ * validates the header, resizes the file and remaps it, but knows nothing of
+ * the records beyond their size and the version number recorded in the
+ * header. This lets a caller open a file and decide how to read or migrate it
+ * from recordVersion() and recordSize() before committing to a record type,
+ * and keeps the mmap machinery out of every MappedDiskVector<T>
+ * instantiation.
+ *
+ * While alive, MappedDiskStorage holds an exclusive lock on the file to
+ * avoid multiple processes manipulating it at the same time. Where open file
+ * description locks are available, that lock is taken with fcntl(), and the
+ * flock is shared, so that other processes can still inspect the file with
+ * openReadOnly().
+ *
+ * MappedDiskStorage is not thread-safe. See ConcurrentMappedDiskVector for a
+ * way to read records while the file grows.
+ */
+class MappedDiskStorage {
+ public:
+  /**
+   * The version and size of the records stored in a file.
+   */
+  struct RecordFormat {
+    uint32_t version;
+    uint32_t size;
+  };
+
+  /**
+   * The on-disk header. Records immediately follow it.
+   */
+  struct Header {
+    uint32_t magic;
+    uint32_t version; // 1
+    uint32_t recordVersion; // T::VERSION
+    uint32_t recordSize; // sizeof(T)
+    uint64_t entryCount; // end() - begin()
+    uint32_t flags; // kHeaderChecksum | kRecordChecksums, 0 in older files
+    uint32_t checksum; // CRC32C of the bytes above, if kHeaderChecksum
+  };
+  static_assert(
+      32 == sizeof(Header),
+      "changing the header size would invalidate all files");
+  static_assert(
+      0 == sizeof(Header) % 16,
+      "header alignment is 16 bytes in case someone uses SSE values");
+
+  static constexpr uint32_t kMagic = 0x0056444d; // "MDV\0"
+
+  /// Header::flags bits.
+  static constexpr uint32_t kHeaderChecksum = 1;
+  static constexpr uint32_t kRecordChecksums = 2;
+
+  /**
+   * Records are checksummed in blocks of as many whole records as fit in this
+   * many bytes, or one record if they are larger.
+   */
+  static constexpr size_t kChecksumBlockSizeInBytes = 64 * 1024;
+
+  /**
+   * Path of the file holding the record checksums of the file at path.
+   */
+  static std::string checksumPath(folly::StringPiece path);
+
+  /**
+   * Size of a newly created file.
+   */
+  static constexpr size_t kInitialSizeInBytes = 256 * detail::kPageSize;
+
+  /**
+   * The smallest step by which grow() extends the file.
+   */
+  static constexpr size_t kMinimumGrowthInBytes = 256 * detail::kPageSize;
+
+  /**
+   * Opens the file at the specified path, or creates it with an empty array
+   * of records in formatIfNew if it doesn't exist or is empty. The path is
+   * only used to open the file - a single file descriptor is used from then
+   * on with the underlying inode resized in place.
+   *
+   * Throws if the file exists but doesn't have a valid header. The format of
+   * the records is not checked: that is up to the caller.
+   */
+  static MappedDiskStorage open(
+      folly::StringPiece path,
+      RecordFormat formatIfNew,
+      const MappedDiskOptions& options);
+
+  static MappedDiskStorage open(
+      folly::StringPiece path,
+      RecordFormat formatIfNew,
+      bool shouldPopulate = false) {
+    MappedDiskOptions options;
+    options.populate = shouldPopulate;
+    return open(path, formatIfNew, options);
+  }
+
+  /**
+   * Maps the file at the specified path read-only, with a shared lock, so
+   * that a process other than the writer can read the records without
+   * copying them. The writer keeps appending in the meantime: entryCount()
+   * is the count as of the last refresh().
+   *
+   * Throws if the file doesn't exist or doesn't have a valid header. The
+   * checksum options and recover are ignored.
+   */
+  static MappedDiskStorage openReadOnly(
+      folly::StringPiece path,
+      const MappedDiskOptions& options = {});
+
+  /**
+   * Creates a new file with an empty array of records in the given format at
+   * the specified path, overwriting any that was there prior.
+   */
+  static MappedDiskStorage createOrOverwrite(
+      folly::StringPiece path,
+      RecordFormat format,
+      const MappedDiskOptions& options = {});
+
+  MappedDiskStorage(const MappedDiskStorage&) = delete;
+  MappedDiskStorage& operator=(const MappedDiskStorage&) = delete;
+
+  MappedDiskStorage(MappedDiskStorage&& other) noexcept;
+  MappedDiskStorage& operator=(MappedDiskStorage&& other) noexcept;
+
+  ~MappedDiskStorage();
+
+  uint32_t recordVersion() const {
+    return header().recordVersion;
+  }
+
+  uint32_t recordSize() const {
+    return header().recordSize;
+  }
+
+  RecordFormat recordFormat() const {
+    return RecordFormat{recordVersion(), recordSize()};
+  }
+
+  /**
+   * The number of records in use, as recorded in the header. For read-only
+   * storage, as of the last refresh(), and never more than the file holds.
+   */
+  uint64_t entryCount() const {
+    return readOnly_ ? readOnlyEntryCount_ : header().entryCount;
+  }
+
+  bool readOnly() const {
+    return readOnly_;
+  }
+
+  /**
+   * Only for read-only storage: read the header again, map any growth of the
+   * file and return the new entryCount(). The mapping may move.
+   *
+   * Throws if the header checksum does not match after several attempts,
+   * which means the header is corrupt rather than being written.
+   */
+  uint64_t refresh();
+
+  void setEntryCount(uint64_t entryCount) {
+    header().entryCount = entryCount;
+    if (header().flags & kHeaderChecksum) {
+      updateHeaderChecksum();
+    }
+    headerDirty_ = durability_ != MappedDiskDurability::None;
+  }
+
+  /**
+   * Whether records are checksummed. See MappedDiskOptions::checksumRecords.
+   */
+  bool hasRecordChecksums() const {
+    return recordChecksums_ != nullptr;
+  }
+
+  MappedDiskDurability durability() const {
+    return durability_;
+  }
+
+  /**
+   * Change how modifications are flushed. Writes made while the durability
+   * was None were not tracked, so switching away from None marks the whole
+   * file as dirty.
+   */
+  void setDurability(MappedDiskDurability durability);
+
+  /**
+   * Record that the bytes [offset, offset + length) of the mapping, counted
+   * from the start of the file, were modified. A no-op when the durability
+   * is None.
+   */
+  void markDirty(size_t offset, size_t length) {
+    if (durability_ != MappedDiskDurability::None) {
+      dirty_.add(offset, offset + length);
+    }
+    if (recordChecksums_) {
+      staleChecksums_.add(offset, offset + length);
+    }
+  }
+
+  /**
+   * Recompute the checksums of the records modified since the last flush,
+   * then write those pages back to the file, as the durability mode dictates.
+   * Only pages marked dirty are synced, rather than the whole mapping.
+   */
+  void flush();
+
+  const MappedDiskOptions& options() const {
+    return options_;
+  }
+
+  /**
+   * Change the access pattern hint, for instance to Sequential before a full
+   * scan and back to Random afterwards.
+   */
+  void setAccessPattern(MappedDiskAccessPattern accessPattern);
+
+  /**
+   * The start of the record array, right after the header.
+   */
+  void* records() {
+    return static_cast<Header*>(map_) + 1;
+  }
+
+  const void* records() const {
+    return static_cast<const Header*>(map_) + 1;
+  }
+
+  /**
+   * Size of the file: always a nonzero multiple of the page size. All of it
+   * is mapped.
+   */
+  size_t sizeInBytes() const {
+    return mapSizeInBytes_;
+  }
+
+  /**
+   * Length of the address range mapped for the file, which may extend past
+   * its end. See reserveAddressSpace().
+   */
+  size_t reservedSizeInBytes() const {
+    return reservedSizeInBytes_;
+  }
+
+  /**
+   * Number of bytes available for records after the header.
+   */
+  size_t recordCapacityInBytes() const {
+    return mapSizeInBytes_ - sizeof(Header);
+  }
+
+  /**
+   * Resizes the file to newSizeInBytes, which must be a multiple of the page
+   * size. If the file grows past the reserved address space, it is remapped
+   * and the mapping may move, invalidating pointers into records().
+   */
+  void resize(size_t newSizeInBytes);
+
+  /**
+   * Grows the file to at least minimumSizeInBytes. The file grows by at least
+   * half of its current size, so that a long series of appends only resizes
+   * it a logarithmic number of times, but not past the reserved address space
+   * when minimumSizeInBytes fits in it.
+   */
+  void grow(size_t minimumSizeInBytes);
+
+  /**
+   * Maps sizeInBytes of address space for the file, even though it is
+   * smaller, so that it can grow up to that size without the mapping ever
+   * moving. Pages past the end of the file must not be accessed. Remaps the
+   * file if the reservation grows, so this should be called before any
+   * pointer into records() is handed out.
+   */
+  void reserveAddressSpace(size_t sizeInBytes);
+
+ private:
+  MappedDiskStorage(
+      folly::File file,
+      size_t fileSize,
+      const MappedDiskOptions& options,
+      bool readOnly);
+
+  static constexpr int kMaxRefreshAttempts = 100;
+
+  /// The mmap() protection flags.
+  int protection() const;
+
+  static MappedDiskStorage initializeFromScratch(
+      folly::File file,
+      RecordFormat format,
+      const MappedDiskOptions& options);
+
+  Header& header() {
+    return *static_cast<Header*>(map_);
+  }
+
+  const Header& header() const {
+    return *static_cast<const Header*>(map_);
+  }
+
+  void syncRange(size_t begin, size_t end, int flags);
+  void remap(size_t newMappingSize);
+
+  static uint32_t computeHeaderChecksum(const Header& header);
+  void updateHeaderChecksum();
+
+  /**
+   * Open or create the record checksums of the file at path, as the header
+   * flags and options_ require, and set the header flags accordingly. With
+   * options_.recover, truncate the records to those that verify.
+   */
+  void attachChecksums(folly::StringPiece path, bool isNew);
+
+  size_t recordsPerChecksumBlock() const;
+
+  /**
+   * The number of leading records that match their checksums.
+   */
+  uint64_t verifiedEntryCount() const;
+
+  /**
+   * Recompute the checksums of the blocks marked stale, and of the last
+   * block, whose length may have changed.
+   */
+  void updateRecordChecksums();
+
+  /**
+   * Bring the checksums up to date before the mapping goes away.
+   */
+  void close() noexcept;
+
+  /**
+   * Apply the madvise() hints in options_ to the whole mapping. They are
+   * applied again whenever the mapping is replaced.
+   */
+  void applyAdvice();
+
+  /**
+   * Lock as much of the prefix requested in options_ as the file covers.
+   */
+  void lockPrefix();
+  void unlockPrefix();
+
+  void* map_{nullptr};
+  size_t mapSizeInBytes_{0}; // must be nonzero, multiple of page size
+  size_t reservedSizeInBytes_{0}; // length of the mapping, >= mapSizeInBytes_
+
+  folly::File file_;
+
+  MappedDiskOptions options_;
+  size_t lockedSizeInBytes_{0};
+
+  bool readOnly_{false};
+  /// The validated entry count of read-only storage, see refresh().
+  uint64_t readOnlyEntryCount_{0};
+
+  MappedDiskDurability durability_{MappedDiskDurability::None};
+  bool headerDirty_{false};
+  /// Byte ranges of the records modified since the last flush.
+  CoverageSet dirty_;
+
+  /// One CRC32C per block of records, if they are checksummed.
+  std::unique_ptr<MappedDiskStorage> recordChecksums_;
+  /// Byte ranges of the records modified since their checksums were updated.
+  CoverageSet staleChecksums_;
+};
+
+} // namespace facebook::eden
@@ -8,36 +8,34 @@
 #pragma once
 
 #include <folly/portability/Unistd.h>
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <eden/common/utils/Bug.h>
+#include <eden/common/utils/MappedDiskStorage.h>
+#include <folly/Conv.h>
 #include <folly/Exception.h>
-#include <folly/File.h>
-#include <folly/FileUtil.h>
 #include <folly/Range.h>
+#include <folly/ScopeGuard.h>
 #include <folly/logging/xlog.h>
 
-#ifndef _WIN32
-#include <sys/mman.h>
-#endif
-
 namespace facebook::eden {
 
 namespace detail {
 
-/**
- * The precise value of kPageSize doesn't matter for correctness.  It's used
- * primarily as a microoptimization - MappedDiskVector attempts to avoid mapping
- * fractions of pages which lets it resize the file a bit less often.
- */
-constexpr size_t kPageSize = 4096;
-
-inline size_t roundUpToNonzeroPageSize(size_t s) {
-  static_assert(
-      0 == (kPageSize & (kPageSize - 1)), "kPageSize must be power of two");
-  return std::max(kPageSize, (s + kPageSize - 1) & ~(kPageSize - 1));
-}
-
 /**
  * Enforce required properties of
  */
@@ -75,16 +73,120 @@ template <typename T, typename... OldVersions>
 struct Migrator;
 } // namespace detail
 
+/**
+ * Controls how MappedDiskVector::open() converts a file from an old record
+ * format.
+ */
+struct MappedDiskMigrationOptions {
+  /**
+   * Number of threads converting records, including the calling thread. 0
+   * means one per hardware thread.
+   */
+  size_t threads{0};
+
+  /**
+   * Number of records a thread converts at a time.
+   */
+  size_t chunkSize{size_t{1} << 16};
+
+  /**
+   * If set, called after each chunk with the number of records converted so
+   * far and the total. Calls may come from any of the converting threads, but
+   * never concurrently.
+   */
+  std::function<void(size_t converted, size_t total)> progress;
+};
+
+namespace detail {
+
+/**
+ * Construct out[i] from convert(in[i]) for every i below count, splitting the
+ * work in chunks across options.threads threads. If a conversion throws, the
+ * remaining chunks are skipped and the first exception is rethrown.
+ */
+template <typename From, typename To, typename ConvertFn>
+void convertRecords(
+    const From* in,
+    To* out,
+    size_t count,
+    const ConvertFn& convert,
+    const MappedDiskMigrationOptions& options) {
+  size_t chunkSize = std::max<size_t>(1, options.chunkSize);
+  size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+  size_t threadCount = options.threads != 0
+      ? options.threads
+      : std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min(threadCount, chunkCount);
+
+  std::atomic<size_t> nextChunk{0};
+  std::atomic<bool> failed{false};
+  std::mutex mutex;
+  std::exception_ptr error;
+  size_t converted = 0;
+
+  auto work = [&] {
+    while (!failed.load(std::memory_order_relaxed)) {
+      size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= chunkCount) {
+        return;
+      }
+      size_t begin = chunk * chunkSize;
+      size_t end = std::min(begin + chunkSize, count);
+      try {
+        for (size_t i = begin; i < end; ++i) {
+          new (out + i) To{convert(in[i])}; // may throw
+        }
+      } catch (...) {
+        std::lock_guard lock{mutex};
+        if (!error) {
+          error = std::current_exception();
+        }
+        failed.store(true, std::memory_order_relaxed);
+        return;
+      }
+      if (options.progress) {
+        std::lock_guard lock{mutex};
+        converted += end - begin;
+        options.progress(converted, count);
+      }
+    }
+  };
+
+  {
+    std::vector<std::thread> threads;
+    SCOPE_EXIT {
+      for (auto& thread : threads) {
+        thread.join();
+      }
+    };
+    for (size_t i = 1; i < threadCount; ++i) {
+      threads.emplace_back(work);
+    }
+    work();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace detail
+
 /**
  * MappedDiskVector is roughly analogous to std::vector, except it's backed by
  * a persistent memory-mapped file.
  *
  * MappedDiskVector is not thread-safe - the caller is
  * responsible for synchronization. It is safe for multiple threads to
- * simultaneously read, however.
+ * simultaneously read, however. Growing the file may move its mapping, so
+ * readers must not run concurrently with appends; ConcurrentMappedDiskVector
+ * allows that.
  *
- * While alive, MappedDiskVector does acquire an exclusive flock on the
- * underlying fd to avoid multiple processes manipulating it at the same time.
+ * While alive, a writable MappedDiskVector holds an exclusive lock on the
+ * file to avoid multiple processes manipulating it at the same time. Where
+ * open file description locks are available, that lock is taken with fcntl(),
+ * and the flock is shared, so that other processes can still inspect the file
+ * with openReadOnly(), which only takes a shared flock.
  *
  * MappedDiskVector supports migrating from old formats to new formats via the
  * OldVersions template parameter. For any given type T, T::VERSION is written
@@ -97,16 +199,12 @@ struct Migrator;
  * an instance of the type of the right. When migrating from C to A above,
  * the new file will contain values constructed with C{B{oldA}}.
  *
- * This type needs to be split into two: the non-template, untyped storage
- * class that manages resizing the file and mapping and parsing the header,
- * and the typed view that owns the storage and exposes it as a typed vector.
- *
- * The caller needs the ability to read userVersion and negotiate an upgrade.
- * I imagine a new type that owns the file handle and allows reading the file
- * size and header, independent of the desired T.  The call can use entrySize
- * and/or userVersion to decide whether to migrate the file's contents into
- * a new file.  Then this type would be moved into a new MappedDiskVector<T>
- * and accessed as a vector afterwards.
+ * MappedDiskVector is a typed view over a MappedDiskStorage, which owns the
+ * file, its mapping and its header. Callers that need to negotiate an upgrade
+ * themselves can open a MappedDiskStorage, inspect its recordVersion() and
+ * recordSize(), and then move it into the MappedDiskVector<T> that matches.
+ * release() hands the storage back, so one mapping can be viewed as several
+ * record types in turn.
  */
 template <
     typename T,
@@ -120,50 +218,27 @@ class MappedDiskVector {
    *
    * If the load fails because of a version mismatch, the types specified in
    * OldVersions are tried sequentially. If one succeeds, the entries are
-   * converted one-by-one into the new format and the new table replaces the
-   * old.
+   * converted into the new format and the new table replaces the old. See
+   * MappedDiskMigrationOptions.
    */
   template <typename... OldVersions>
   static MappedDiskVector open(
       folly::StringPiece path,
       bool shouldPopulate = false) {
-    folly::File file{path, O_RDWR | O_CREAT | O_CLOEXEC, 0600};
-
-    if (!file.try_lock()) {
-      folly::throwSystemError("failed to acquire lock on ", path);
-    }
-
-    struct stat st;
-    folly::checkUnixError(
-        fstat(file.fd(), &st), "fstat failed on MappedDiskVector path ", path);
-
-    if (st.st_size == 0) {
-      return initializeFromScratch(std::move(file));
-    }
-
-    Header header;
-    ssize_t readBytes =
-        folly::preadNoInt(file.fd(), &header, sizeof(header), 0);
-    if (readBytes == -1) {
-      folly::throwSystemError("failed to read MappedDiskVector header");
-    } else if (readBytes != sizeof(header)) {
-      XLOGF(
-          WARNING,
-          "file contains incomplete header: only read {} bytes",
-          readBytes);
-      throw std::runtime_error("Incomplete MappedDiskVector header");
-    }
-
-    if (kMagic != header.magic || header.version != 1 ||
-        static_cast<ssize_t>(sizeof(header)) > st.st_size ||
-        header.recordSize == 0 ||
-        // careful not to overflow by multiplying entryCount by recordSize
-        header.entryCount > (st.st_size - sizeof(header)) / header.recordSize ||
-        header.unused != 0) {
-      throw std::runtime_error(
-          "Invalid header: this is probably not a MappedDiskVector file");
-    }
+    MappedDiskOptions options;
+    options.populate = shouldPopulate;
+    return open<OldVersions...>(path, options);
+  }
 
+  /**
+   * Same as above, with control over how the file is mapped. See
+   * MappedDiskOptions.
+   */
+  template <typename... OldVersions>
+  static MappedDiskVector open(
+      folly::StringPiece path,
+      const MappedDiskOptions& options,
+      const MappedDiskMigrationOptions& migrationOptions = {}) {
     // Verify that every given record type has a unique VERSION value.
     // This check could be done at compile time.
     static constexpr std::array<uint32_t, 1 + sizeof...(OldVersions)> versions =
@@ -178,120 +253,171 @@ class MappedDiskVector {
       }
     }
 
-    // Does this file match the primary record type? If so, we're done.
-    if (T::VERSION == header.recordVersion) {
-      if (sizeof(T) != header.recordSize) {
-        throw std::runtime_error(
-            folly::to<std::string>(
-                "Record size does not match size recorded in file. Expected ",
-                sizeof(T),
-                " but file has ",
-                header.recordSize));
-      }
-      return MappedDiskVector{
-          std::move(file), st.st_size, header.entryCount, shouldPopulate};
+    auto storage = MappedDiskStorage::open(path, recordFormat(), options);
+
+    // Does this file match the primary record type? If so, we're done. The
+    // constructor reports any other mismatch if no old version matches.
+    auto recordVersion = storage.recordVersion();
+    if (T::VERSION == recordVersion) {
+      return MappedDiskVector{std::move(storage)};
     }
 
     // Try to migrate from an old record format if any match.
     static constexpr std::array<size_t, sizeof...(OldVersions)> sizes = {
         sizeof(OldVersions)...};
     for (size_t i = 0; i < sizes.size(); ++i) {
-      if (versions[i + 1] == header.recordVersion) {
-        if (sizes[i] != header.recordSize) {
+      if (versions[i + 1] == recordVersion) {
+        if (sizes[i] != storage.recordSize()) {
           throw std::runtime_error(
               folly::to<std::string>(
                   "Record version matches old record type but record size differs. ",
                   "Expected ",
                   sizes[i],
                   " but file has ",
-                  header.recordSize));
+                  storage.recordSize()));
         }
         return detail::Migrator<T, OldVersions...>::migrateFrom(
             path,
-            std::move(file),
-            st.st_size,
-            header.entryCount,
+            std::move(storage),
             i,
-            [](const auto& from) { return T{from}; });
+            [](const auto& from) { return T{from}; },
+            migrationOptions);
       }
     }
 
-    throw std::runtime_error(
-        folly::to<std::string>(
-            "Unexpected record size and version. "
-            "Expected size=",
-            sizeof(T),
-            ", version=",
-            T::VERSION,
-            " but got size=",
-            header.recordSize,
-            ", version=",
-            header.recordVersion));
+    return MappedDiskVector{std::move(storage)};
+  }
+
+  /**
+   * Opens the MappedDiskVector at the specified path for reading only, with a
+   * shared lock, so that processes other than the one that owns it can
+   * inspect it in place. The records must already be in format T: there is no
+   * migration.
+   *
+   * The owner may keep appending: the vector holds the records that existed
+   * as of the last refresh(). Only the const methods and refresh() may be
+   * called on a read-only vector.
+   */
+  static MappedDiskVector openReadOnly(
+      folly::StringPiece path,
+      const MappedDiskOptions& options = {}) {
+    return MappedDiskVector{MappedDiskStorage::openReadOnly(path, options)};
   }
 
   /**
    * Creates a new MappedDiskVector at the specified path, overwriting any that
    * was there prior.
    */
-  static MappedDiskVector createOrOverwrite(folly::StringPiece path) {
-    folly::File file{
-        path, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0600};
-    if (!file.try_lock()) {
-      folly::throwSystemError("failed to acquire lock on ", path);
+  static MappedDiskVector createOrOverwrite(
+      folly::StringPiece path,
+      const MappedDiskOptions& options = {}) {
+    return MappedDiskVector{
+        MappedDiskStorage::createOrOverwrite(path, recordFormat(), options)};
+  }
+
+  /**
+   * The record format of T, as recorded in the file header.
+   */
+  static constexpr MappedDiskStorage::RecordFormat recordFormat() {
+    return MappedDiskStorage::RecordFormat{T::VERSION, sizeof(T)};
+  }
+
+  /**
+   * View storage as a vector of T. Throws if the records in storage were not
+   * written as T.
+   */
+  explicit MappedDiskVector(MappedDiskStorage storage)
+      : storage_(std::move(storage)) {
+    if (T::VERSION != storage_.recordVersion()) {
+      throw std::runtime_error(
+          folly::to<std::string>(
+              "Unexpected record size and version. "
+              "Expected size=",
+              sizeof(T),
+              ", version=",
+              T::VERSION,
+              " but got size=",
+              storage_.recordSize(),
+              ", version=",
+              storage_.recordVersion()));
     }
+    if (sizeof(T) != storage_.recordSize()) {
+      throw std::runtime_error(
+          folly::to<std::string>(
+              "Record size does not match size recorded in file. Expected ",
+              sizeof(T),
+              " but file has ",
+              storage_.recordSize()));
+    }
+
+    static_assert(
+        alignof(MappedDiskStorage::Header) >= alignof(T),
+        "T must not have stricter alignment requirements than Header");
+    updatePointers(storage_.entryCount());
 
-    return initializeFromScratch(std::move(file));
+    // Just double-check that the accessed region is within the map.
+    XCHECK_LE(
+        reinterpret_cast<char*>(end_),
+        static_cast<char*>(storage_.records()) +
+            storage_.recordCapacityInBytes());
   }
 
   explicit MappedDiskVector() = delete;
   MappedDiskVector(const MappedDiskVector&) = delete;
   MappedDiskVector& operator=(const MappedDiskVector&) = delete;
 
-  MappedDiskVector(MappedDiskVector&& other) : file_(std::move(other.file_)) {
-    begin_ = other.begin_;
-    end_ = other.end_;
-    map_ = other.map_;
-    mapSizeInBytes_ = other.mapSizeInBytes_;
+  MappedDiskVector(MappedDiskVector&& other) noexcept
+      : begin_{std::exchange(other.begin_, nullptr)},
+        end_{std::exchange(other.end_, nullptr)},
+        storage_{std::move(other.storage_)} {}
 
-    other.begin_ = nullptr;
-    other.end_ = nullptr;
-    other.map_ = nullptr;
-    other.mapSizeInBytes_ = 0;
+  MappedDiskVector& operator=(MappedDiskVector&& other) noexcept {
+    begin_ = std::exchange(other.begin_, nullptr);
+    end_ = std::exchange(other.end_, nullptr);
+    storage_ = std::move(other.storage_);
+    return *this;
   }
 
-  MappedDiskVector& operator=(MappedDiskVector&& other) {
-    if (map_) {
-      munmap(map_, mapSizeInBytes_);
-    }
-
-    file_ = std::move(other.file_);
-    begin_ = other.begin_;
-    end_ = other.end_;
-    map_ = other.map_;
-    mapSizeInBytes_ = other.mapSizeInBytes_;
+  /**
+   * Give up the typed view and return the underlying storage, which may then
+   * be viewed as another record type.
+   */
+  MappedDiskStorage release() && {
+    begin_ = nullptr;
+    end_ = nullptr;
+    return std::move(storage_);
+  }
 
-    other.begin_ = nullptr;
-    other.end_ = nullptr;
-    other.map_ = nullptr;
-    other.mapSizeInBytes_ = 0;
+  size_t size() const {
+    return end_ - begin_;
   }
 
-  ~MappedDiskVector() {
-    if (map_) {
-      munmap(map_, mapSizeInBytes_);
-    }
+  bool readOnly() const {
+    return storage_.readOnly();
   }
 
-  size_t size() const {
-    return end_ - begin_;
+  /**
+   * For a read-only vector, pick up the records appended by the owner since
+   * the vector was opened or last refreshed, after validating the record
+   * count against the file. Returns the new size. Invalidates pointers and
+   * references into the vector.
+   */
+  size_t refresh() {
+    updatePointers(storage_.refresh());
+    return size();
   }
 
   size_t capacity() const {
     // round down
-    return (mapSizeInBytes_ - sizeof(Header)) / sizeof(T);
+    return storage_.recordCapacityInBytes() / sizeof(T);
   }
 
+  /**
+   * Unless the durability is None, taking a mutable reference to a record
+   * marks it as modified, to be written by the next flush().
+   */
   T& operator[](size_t index) {
+    markDirty(begin_ + index, 1);
     return begin_[index];
   }
 
@@ -299,198 +425,178 @@ class MappedDiskVector {
     return begin_[index];
   }
 
+  /**
+   * Make room for at least n records, resizing the file at most once. Unlike
+   * the growth triggered by appends, this does not over-allocate.
+   */
+  void reserve(size_t n) {
+    if (n > capacity()) {
+      resizeFor(n);
+    }
+  }
+
   template <typename... Args>
   void emplace_back(Args&&... args) {
+    XDCHECK(!readOnly());
     if (!hasRoom(1)) {
-      static_assert(
-          sizeof(GROWTH_IN_PAGES) * detail::kPageSize >= sizeof(T),
-          "Growth must expand the file more than a single record");
+      grow(1);
+    }
 
-      size_t oldSize = size();
-      size_t newFileSize =
-          mapSizeInBytes_ + GROWTH_IN_PAGES * detail::kPageSize;
+    T* out = end_;
+    new (out) T{std::forward<Args>(args)...}; // may throw
+    end_ = out + 1;
 
-      // Always keep the file size a whole number of pages.
-      XCHECK_EQ(0ul, newFileSize % detail::kPageSize);
+    markDirty(out, 1);
+    storage_.setEntryCount(storage_.entryCount() + 1);
+  }
 
-      if (-1 == folly::ftruncateNoInt(file_.fd(), newFileSize)) {
-        folly::throwSystemError("ftruncateNoInt failed when growing capacity");
+  /**
+   * Append every element of range, each of which is used to construct a T.
+   *
+   * When the size of the range is known up front, the file is resized at
+   * most once. In all cases the header is only updated once, after the last
+   * record is written, rather than once per record as emplace_back() does.
+   * If constructing a record throws, the records appended before it are kept.
+   */
+  template <typename Range>
+  void append(Range&& range) {
+    using std::begin;
+    using std::end;
+    auto first = begin(range);
+    auto last = end(range);
+    using Iterator = decltype(first);
+    constexpr bool kIsSized = std::is_base_of_v<
+        std::forward_iterator_tag,
+        typename std::iterator_traits<Iterator>::iterator_category>;
+
+    if constexpr (kIsSized) {
+      size_t count = std::distance(first, last);
+      if (!hasRoom(count)) {
+        grow(count);
       }
+    }
 
-#ifdef __APPLE__
-      auto newMap = mmap(
-          nullptr,
-          newFileSize,
-          PROT_READ | PROT_WRITE,
-          MAP_SHARED,
-          file_.fd(),
-          0);
-#else
-      auto newMap = mremap(map_, mapSizeInBytes_, newFileSize, MREMAP_MAYMOVE);
-#endif
-      if (newMap == MAP_FAILED) {
-        folly::throwSystemError(
-            folly::to<std::string>(
-                "mremap failed when growing capacity from ",
-                mapSizeInBytes_,
-                " to ",
-                newFileSize));
+    size_t oldSize = size();
+    SCOPE_EXIT {
+      markDirty(begin_ + oldSize, size() - oldSize);
+      storage_.setEntryCount(size());
+    };
+    for (; first != last; ++first) {
+      if constexpr (!kIsSized) {
+        if (!hasRoom(1)) {
+          grow(1);
+        }
       }
-
-#ifdef __APPLE__
-      munmap(map_, mapSizeInBytes_);
-#endif
-      map_ = newMap;
-      mapSizeInBytes_ = newFileSize;
-
-      begin_ = reinterpret_cast<T*>(static_cast<Header*>(newMap) + 1);
-      end_ = begin_ + oldSize;
+      new (end_) T{*first}; // may throw
+      ++end_;
     }
-
-    T* out = end_;
-    new (out) T{std::forward<Args>(args)...}; // may throw
-    end_ = out + 1;
-
-    ++header().entryCount;
   }
 
   void pop_back() {
     // TODO: It might be worth eliminating the end_ pointer and always adding
-    // header().entryCount to begin_.
+    // the header's entryCount to begin_.
     XDCHECK_GT(end_, begin_);
     --end_;
-    --header().entryCount;
+    storage_.setEntryCount(storage_.entryCount() - 1);
   }
 
   T& front() {
     XDCHECK_GT(end_, begin_);
+    markDirty(begin_, 1);
     return begin_[0];
   }
 
   T& back() {
     XDCHECK_GT(end_, begin_);
+    markDirty(end_ - 1, 1);
     return end_[-1];
   }
 
- private:
-  static constexpr uint32_t kMagic = 0x0056444d; // "MDV\0"
-
-  struct Header {
-    uint32_t magic;
-    uint32_t version; // 1
-    uint32_t recordVersion; // T::VERSION
-    uint32_t recordSize; // sizeof(T)
-    uint64_t entryCount; // end() - begin()
-    uint64_t unused; // for alignment
-  };
-  static_assert(
-      32 == sizeof(Header),
-      "changing the header size would invalidate all files");
-  static_assert(
-      0 == sizeof(Header) % 16,
-      "header alignment is 16 bytes in case someone uses SSE values");
+  MappedDiskDurability durability() const {
+    return storage_.durability();
+  }
 
-  static constexpr size_t GROWTH_IN_PAGES = 256;
+  /**
+   * See MappedDiskDurability. The default is None.
+   */
+  void setDurability(MappedDiskDurability durability) {
+    storage_.setDurability(durability);
+  }
 
-  static MappedDiskVector initializeFromScratch(folly::File file) {
-    // Start the file large enough to handle the header and a little under one
-    // round one of growth.
-    constexpr size_t initialSize = GROWTH_IN_PAGES * detail::kPageSize;
-    static_assert(
-        initialSize >= sizeof(Header) + sizeof(T),
-        "Initial size must include enough space for the header and at least one element.");
-    if (-1 == folly::ftruncateNoInt(file.fd(), initialSize)) {
-      folly::throwSystemError(
-          "failed to initialize MappedDiskVector: ftruncate() failed");
-    }
+  /**
+   * Write the records modified since the last flush, and then the header,
+   * back to the file as the durability mode dictates. Does nothing when the
+   * durability is None.
+   */
+  void flush() {
+    storage_.flush();
+  }
 
-    Header header;
-    header.magic = kMagic;
-    header.version = 1;
-    header.recordVersion = T::VERSION;
-    header.recordSize = sizeof(T);
-    header.entryCount = 0;
-    header.unused = 0;
-    ssize_t written = folly::pwriteNoInt(file.fd(), &header, sizeof(header), 0);
-    if (-1 == written) {
-      folly::throwSystemError("Failed to write initial header");
-    }
-    if (written != sizeof(header)) {
-      throw std::runtime_error("Failed to write complete initial header");
-    }
+  /**
+   * See MappedDiskStorage::setAccessPattern().
+   */
+  void setAccessPattern(MappedDiskAccessPattern accessPattern) {
+    storage_.setAccessPattern(accessPattern);
+  }
 
-    return MappedDiskVector{
-        std::move(file), initialSize, header.entryCount, false};
-  }
-
-  explicit MappedDiskVector(
-      folly::File file,
-      off_t fileSize,
-      size_t currentEntryCount,
-      bool populate)
-      : file_(std::move(file)) {
-    // It's worth keeping the file and mapping a whole number of pages to
-    // avoid wasting an partial page at the end.  Note that this is an
-    // optimization and it doesn't matter if kPageSize differs from the
-    // system page size.
-    size_t desiredSize = detail::roundUpToNonzeroPageSize(fileSize);
-    if (fileSize != static_cast<ssize_t>(desiredSize)) {
-      if (fileSize) {
-        XLOGF(
-            WARNING,
-            "Warning: MappedDiskVector file size not multiple of page size: {}",
-            fileSize);
-      }
-      if (folly::ftruncateNoInt(file_.fd(), desiredSize)) {
-        folly::throwSystemError(
-            "ftruncateNoInt failed when rounding up to page size");
-      }
-    }
+ private:
+  static_assert(
+      MappedDiskStorage::kInitialSizeInBytes >=
+          sizeof(MappedDiskStorage::Header) + sizeof(T),
+      "Initial size must include enough space for the header and at least one element.");
 
-    // Call readahead() here?  Offer it as optional functionality?
-    // InodeTable needs to traverse every record immediately after opening.
-
-    auto map = mmap(
-        nullptr,
-        desiredSize,
-        PROT_READ | PROT_WRITE,
-        MAP_SHARED
-#ifdef MAP_POPULATE
-            | (populate ? MAP_POPULATE : 0)
-#endif
-            ,
-        file_.fd(),
-        0);
-    if (map == MAP_FAILED) {
-      folly::throwSystemError("mmap failed on file open");
-    }
+  static_assert(
+      MappedDiskStorage::kMinimumGrowthInBytes >= sizeof(T),
+      "Growth must expand the file more than a single record");
 
-#ifndef MAP_POPULATE
-    (void)populate;
-#endif
+  /**
+   * Grow the file, geometrically, to fit `amount` more records.
+   */
+  void grow(size_t amount) {
+    size_t oldSize = size();
+    storage_.grow(
+        sizeof(MappedDiskStorage::Header) + (oldSize + amount) * sizeof(T));
+    updatePointers(oldSize);
+  }
 
-    // Throw no exceptions between assigning the fields.
+  /**
+   * Resize the file to the smallest whole number of pages that fits n
+   * records.
+   */
+  void resizeFor(size_t n) {
+    if (n > (std::numeric_limits<size_t>::max() -
+             sizeof(MappedDiskStorage::Header)) /
+            sizeof(T)) {
+      throw std::length_error("MappedDiskVector capacity overflow");
+    }
+    size_t oldSize = size();
+    storage_.resize(detail::roundUpToNonzeroPageSize(
+        sizeof(MappedDiskStorage::Header) + n * sizeof(T)));
+    updatePointers(oldSize);
+  }
 
-    map_ = map;
-    mapSizeInBytes_ = desiredSize;
-    static_assert(
-        alignof(Header) >= alignof(T),
-        "T must not have stricter alignment requirements than Header");
-    begin_ = reinterpret_cast<T*>(static_cast<Header*>(map) + 1);
-    end_ = begin_ + currentEntryCount;
+  void markDirty(const T* first, size_t count) {
+    if (count != 0) {
+      storage_.markDirty(
+          reinterpret_cast<const char*>(first) -
+              static_cast<const char*>(storage_.records()) +
+              sizeof(MappedDiskStorage::Header),
+          count * sizeof(T));
+    }
+  }
 
-    // Just double-check that the accessed region is within the map.
-    XCHECK_LE(
-        reinterpret_cast<char*>(end_),
-        static_cast<char*>(map_) + mapSizeInBytes_);
+  void updatePointers(size_t entryCount) {
+    begin_ = static_cast<T*>(storage_.records());
+    end_ = begin_ + entryCount;
   }
 
   bool hasRoom(size_t amount) const {
     // Technically, the expression (end_ + amount) is constructing a pointer
     // past the end of the "object" (mmap) and is thus UB.  But hopefully no
     // compiler can see that.
-    return reinterpret_cast<char*>(end_ + amount) <=
-        static_cast<char*>(map_) + mapSizeInBytes_;
+    return reinterpret_cast<const char*>(end_ + amount) <=
+        static_cast<const char*>(storage_.records()) +
+        storage_.recordCapacityInBytes();
   }
 
   T* data() {
@@ -513,22 +619,11 @@ class MappedDiskVector {
     return end_;
   }
 
-  Header& header() {
-    return *static_cast<Header*>(map_);
-  }
-
-  const Header& header() const {
-    return *static_cast<Header*>(map_);
-  }
-
   // these two should be at the front of the struct
   T* begin_{nullptr};
   T* end_{nullptr};
 
-  void* map_{nullptr};
-  size_t mapSizeInBytes_{0}; // must be nonzero, multiple of page size
-
-  folly::File file_;
+  MappedDiskStorage storage_;
 
   template <typename T_, typename... OldVersions>
   friend struct detail::Migrator;
@@ -540,11 +635,10 @@ struct Migrator<T> {
   template <typename ConvertFn>
   [[noreturn]] static MappedDiskVector<T> migrateFrom(
       folly::StringPiece /*path*/,
-      folly::File /*file*/,
-      off_t /*fileSize*/,
-      size_t /*currentEntryCount*/,
+      MappedDiskStorage /*storage*/,
       size_t /*oldVersionIndex*/,
-      ConvertFn /*convert*/) {
+      ConvertFn /*convert*/,
+      const MappedDiskMigrationOptions& /*migrationOptions*/) {
     EDEN_BUG() << "oldVersionIndex >= sizeof...(OldVersions)";
   }
 };
@@ -554,51 +648,79 @@ struct Migrator<T, First, Rest...> {
   template <typename ConvertFn>
   static MappedDiskVector<T> migrateFrom(
       folly::StringPiece path,
-      folly::File file,
-      off_t fileSize,
-      size_t currentEntryCount,
+      MappedDiskStorage storage,
       size_t oldVersionIndex,
-      ConvertFn convert) {
+      ConvertFn convert,
+      const MappedDiskMigrationOptions& migrationOptions) {
     using namespace folly::literals;
 
     // static assert type of fn() is First -> T
 
     if (oldVersionIndex == 0) {
       // At this point, it's clear the original file is compatible with First.
-      // Load it, migrate each element to a new temporary file, and move the
-      // temporary file over the original.
-      // Set populate to true because migrating requires reading every element
-      // anyway.
-      MappedDiskVector<First> original{
-          std::move(file), fileSize, currentEntryCount, true};
+      // View it as such, migrate each element to a new temporary file, and
+      // move the temporary file over the original.
+      auto options = storage.options();
+      MappedDiskVector<First> original{std::move(storage)};
+      original.setAccessPattern(MappedDiskAccessPattern::Sequential);
 
       auto tmpPath = folly::to<std::string>(path, ".tmp");
-      auto newVector = MappedDiskVector<T>::createOrOverwrite(tmpPath);
+      auto newVector = MappedDiskVector<T>::createOrOverwrite(tmpPath, options);
       try {
-        // TODO: newVector.reserve
-        for (size_t i = 0; i < original.size(); ++i) {
-          newVector.emplace_back(convert(original[i]));
+        // Size the new file once, then convert the records in place, in
+        // parallel, and publish them all with a single header update.
+        size_t count = original.size();
+        newVector.reserve(count);
+        convertRecords(
+            original.begin_,
+            newVector.begin_,
+            count,
+            convert,
+            migrationOptions);
+        newVector.end_ = newVector.begin_ + count;
+        newVector.markDirty(newVector.begin_, count);
+        newVector.storage_.setEntryCount(count);
+        // Checksum the records before publishing them: otherwise, a crash
+        // before the new vector is closed leaves a sidecar with no blocks,
+        // and recovery truncates every migrated record.
+        newVector.storage_.flush();
+
+        // The data file and its checksums can't be renamed at once. Remove
+        // the old checksums first, so that a crash in between leaves either
+        // file without a sidecar, whose checksums are then recomputed,
+        // rather than the new records paired with the old checksums.
+        if (newVector.storage_.hasRecordChecksums() &&
+            unlink(MappedDiskStorage::checksumPath(path).c_str()) &&
+            errno != ENOENT) {
+          folly::throwSystemError(
+              "unlink() failed while migrating MDV checksums");
         }
-
         if (rename(tmpPath.c_str(), path.str().c_str())) {
           folly::throwSystemError(
               "rename() failed while migrating MDV formats");
         }
+        if (newVector.storage_.hasRecordChecksums() &&
+            rename(
+                MappedDiskStorage::checksumPath(tmpPath).c_str(),
+                MappedDiskStorage::checksumPath(path).c_str())) {
+          folly::throwSystemError(
+              "rename() failed while migrating MDV checksums");
+        }
 
         return newVector;
       } catch (const std::exception&) {
         unlink(tmpPath.c_str());
+        unlink(MappedDiskStorage::checksumPath(tmpPath).c_str());
         throw;
       }
     }
 
     return Migrator<T, Rest...>::migrateFrom(
         path,
-        std::move(file),
-        fileSize,
-        currentEntryCount,
+        std::move(storage),
         oldVersionIndex - 1,
-        [=](const auto& from) { return convert(First{from}); });
+        [=](const auto& from) { return convert(First{from}); },
+        migrationOptions);
   }
 };
 
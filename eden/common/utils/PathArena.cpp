@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/PathArena.h"
+
+#include <cstring>
+
+namespace facebook::eden {
+
+PathArena::PathArena(size_t initialBlockSize)
+    : resource_{initialBlockSize, std::pmr::new_delete_resource()} {}
+
+char* PathArena::allocate(size_t size) {
+  bytesUsed_ += size;
+  return static_cast<char*>(resource_.allocate(size, 1));
+}
+
+ArenaRelativePath PathArena::copy(RelativePathPiece path) {
+  auto view = path.view();
+  if (view.empty()) {
+    return ArenaRelativePath{};
+  }
+  auto* data = allocate(view.size());
+  std::memcpy(data, view.data(), view.size());
+  return ArenaRelativePath{
+      std::string_view{data, view.size()}, detail::SkipPathSanityCheck{}};
+}
+
+ArenaRelativePath PathArena::join(
+    RelativePathPiece dir,
+    PathComponentPiece name) {
+  return join(dir, RelativePathPiece{name});
+}
+
+ArenaRelativePath PathArena::join(RelativePathPiece a, RelativePathPiece b) {
+  // Mirror operator+: an empty side yields a copy of the other one.
+  if (a.view().empty()) {
+    return copy(b);
+  }
+  if (b.view().empty()) {
+    return copy(a);
+  }
+
+  auto left = a.view();
+  auto right = b.view();
+  auto size = left.size() + kDirSeparatorStr.size() + right.size();
+  auto* data = allocate(size);
+  auto* out = data;
+  std::memcpy(out, left.data(), left.size());
+  out += left.size();
+  std::memcpy(out, kDirSeparatorStr.data(), kDirSeparatorStr.size());
+  out += kDirSeparatorStr.size();
+  std::memcpy(out, right.data(), right.size());
+  return ArenaRelativePath{
+      std::string_view{data, size}, detail::SkipPathSanityCheck{}};
+}
+
+void PathArena::release() {
+  resource_.release();
+  bytesUsed_ = 0;
+}
+
+} // namespace facebook::eden
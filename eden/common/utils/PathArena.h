@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+
+#include "eden/common/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+/**
+ * A RelativePathPiece whose bytes are owned by a PathArena.
+ *
+ * It is an ordinary RelativePathPiece, so it can be compared, hashed, passed
+ * to any function taking a Piece and used as the key of a
+ * PathMap<Value, ArenaRelativePath>. It is only valid until the arena that
+ * built it is released or destroyed.
+ */
+using ArenaRelativePath = RelativePathPiece;
+
+/**
+ * Builds RelativePaths in a monotonic buffer.
+ *
+ * Enumerating a whole tree creates millions of RelativePaths with
+ * operator+, each of which is a separate std::string heap allocation, and all
+ * of them are freed together at the end of the traversal. PathArena hands
+ * out paths carved out of large blocks instead: building a path is a pointer
+ * bump and a copy, and release() drops every path at once.
+ *
+ * Not thread-safe; use one arena per traversal thread.
+ */
+class PathArena {
+ public:
+  static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+  explicit PathArena(size_t initialBlockSize = kDefaultBlockSize);
+
+  PathArena(const PathArena&) = delete;
+  PathArena& operator=(const PathArena&) = delete;
+
+  /**
+   * Return a copy of path stored in the arena.
+   */
+  ArenaRelativePath copy(RelativePathPiece path);
+
+  /**
+   * The arena equivalent of `dir + name`.
+   */
+  ArenaRelativePath join(RelativePathPiece dir, PathComponentPiece name);
+
+  /**
+   * The arena equivalent of `a + b`.
+   */
+  ArenaRelativePath join(RelativePathPiece a, RelativePathPiece b);
+
+  /**
+   * Free every path built by this arena at once. The arena may be reused for
+   * the next traversal afterwards.
+   */
+  void release();
+
+  /**
+   * Number of path bytes stored since construction or the last release().
+   */
+  size_t bytesUsed() const {
+    return bytesUsed_;
+  }
+
+ private:
+  char* allocate(size_t size);
+
+  std::pmr::monotonic_buffer_resource resource_;
+  size_t bytesUsed_{0};
+};
+
+} // namespace facebook::eden
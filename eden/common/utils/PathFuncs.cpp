@@ -12,12 +12,22 @@
 
 #include <folly/Exception.h>
 #include <folly/logging/xlog.h>
+#include <folly/small_vector.h>
 #include <folly/portability/Stdlib.h>
 #include <folly/portability/Unistd.h>
 #include <folly/portability/Windows.h>
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <optional>
 
+#include "eden/common/utils/CpuFeatures.h"
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
 #ifdef __APPLE__
 #include <mach-o/dyld.h> // @manual
 #endif
@@ -44,6 +54,344 @@ std::string_view basename(std::string_view path) {
   return path;
 }
 
+namespace detail {
+namespace {
+
+/**
+ * The bytes that delimit path components, and the bytes other than nul that
+ * may not appear in a path at all. Unused slots hold '\0': nul bytes are
+ * always rejected before delimiters are looked at, so it never acts as one.
+ */
+struct PathByteClasses {
+  char separators[2];
+  char forbidden[2];
+};
+
+constexpr bool isValidComponentShape(const char* begin, size_t size) {
+  switch (size) {
+    case 0:
+      return false;
+    case 1:
+      return begin[0] != '.';
+    case 2:
+      return begin[0] != '.' || begin[1] != '.';
+    default:
+      return true;
+  }
+}
+
+/**
+ * Consumes the bitmasks computed by the validation loops below, where bit i
+ * describes the byte at offset + i, and checks the components they delimit.
+ */
+class PathValidator {
+ public:
+  explicit PathValidator(std::string_view path) : path_{path} {}
+
+  bool consume(
+      size_t offset,
+      uint32_t forbidden,
+      uint32_t separators,
+      uint32_t nonAscii) {
+    if (forbidden != 0) {
+      return false;
+    }
+    if (nonAscii != 0 && firstNonAscii_ == std::string_view::npos) {
+      firstNonAscii_ = offset + std::countr_zero(nonAscii);
+    }
+    while (separators != 0) {
+      size_t pos = offset + std::countr_zero(separators);
+      if (!isValidComponentShape(
+              path_.data() + componentStart_, pos - componentStart_)) {
+        return false;
+      }
+      componentStart_ = pos + 1;
+      separators &= separators - 1;
+    }
+    return true;
+  }
+
+  bool finish() const {
+    if (!isValidComponentShape(
+            path_.data() + componentStart_, path_.size() - componentStart_)) {
+      return false;
+    }
+    // Everything before the first non-ASCII byte is trivially valid UTF-8,
+    // and since ASCII bytes never continue a sequence, validation can start
+    // there. The vast majority of paths never get this far.
+    return firstNonAscii_ == std::string_view::npos ||
+        isValidUtf8(path_.substr(firstNonAscii_));
+  }
+
+ private:
+  std::string_view path_;
+  size_t componentStart_{0};
+  size_t firstNonAscii_{std::string_view::npos};
+};
+
+[[maybe_unused]] bool validatePathScalar(
+    std::string_view path,
+    PathByteClasses classes) {
+  PathValidator validator{path};
+  for (size_t i = 0; i < path.size(); ++i) {
+    char c = path[i];
+    bool forbidden =
+        c == '\0' || c == classes.forbidden[0] || c == classes.forbidden[1];
+    bool separator = c == classes.separators[0] || c == classes.separators[1];
+    bool nonAscii = (folly::to_unsigned(c) & 0x80) != 0;
+    if (!validator.consume(i, forbidden, separator, nonAscii)) {
+      return false;
+    }
+  }
+  return validator.finish();
+}
+
+#if FOLLY_X64
+bool validatePathSse2(std::string_view path, PathByteClasses classes) {
+  constexpr size_t kWidth = sizeof(__m128i);
+  const __m128i nul = _mm_setzero_si128();
+  const __m128i separator0 = _mm_set1_epi8(classes.separators[0]);
+  const __m128i separator1 = _mm_set1_epi8(classes.separators[1]);
+  const __m128i forbidden0 = _mm_set1_epi8(classes.forbidden[0]);
+  const __m128i forbidden1 = _mm_set1_epi8(classes.forbidden[1]);
+
+  PathValidator validator{path};
+  for (size_t offset = 0; offset < path.size(); offset += kWidth) {
+    size_t remaining = path.size() - offset;
+    uint32_t inBounds = 0xffff;
+    __m128i chunk;
+    if (remaining >= kWidth) {
+      chunk = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(path.data() + offset));
+    } else {
+      // Never read past the end of the string: copy the tail out and ignore
+      // the padding.
+      alignas(kWidth) char tail[kWidth] = {};
+      std::memcpy(tail, path.data() + offset, remaining);
+      chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+      inBounds = (1u << remaining) - 1;
+    }
+
+    uint32_t forbidden = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(chunk, nul),
+        _mm_or_si128(
+            _mm_cmpeq_epi8(chunk, forbidden0),
+            _mm_cmpeq_epi8(chunk, forbidden1))));
+    uint32_t separators = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(chunk, separator0), _mm_cmpeq_epi8(chunk, separator1)));
+    uint32_t nonAscii = _mm_movemask_epi8(chunk);
+    if (!validator.consume(
+            offset,
+            forbidden & inBounds,
+            separators & inBounds,
+            nonAscii & inBounds)) {
+      return false;
+    }
+  }
+  return validator.finish();
+}
+
+EDEN_TARGET_ATTRIBUTE("avx2") bool validatePathAvx2(
+    std::string_view path,
+    PathByteClasses classes) {
+  constexpr size_t kWidth = sizeof(__m256i);
+  const __m256i nul = _mm256_setzero_si256();
+  const __m256i separator0 = _mm256_set1_epi8(classes.separators[0]);
+  const __m256i separator1 = _mm256_set1_epi8(classes.separators[1]);
+  const __m256i forbidden0 = _mm256_set1_epi8(classes.forbidden[0]);
+  const __m256i forbidden1 = _mm256_set1_epi8(classes.forbidden[1]);
+
+  PathValidator validator{path};
+  for (size_t offset = 0; offset < path.size(); offset += kWidth) {
+    size_t remaining = path.size() - offset;
+    uint32_t inBounds = 0xffffffff;
+    __m256i chunk;
+    if (remaining >= kWidth) {
+      chunk = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(path.data() + offset));
+    } else {
+      alignas(kWidth) char tail[kWidth] = {};
+      std::memcpy(tail, path.data() + offset, remaining);
+      chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(tail));
+      inBounds = (1u << remaining) - 1;
+    }
+
+    uint32_t forbidden = _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, nul),
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(chunk, forbidden0),
+            _mm256_cmpeq_epi8(chunk, forbidden1))));
+    uint32_t separators = _mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, separator0),
+        _mm256_cmpeq_epi8(chunk, separator1)));
+    uint32_t nonAscii = _mm256_movemask_epi8(chunk);
+    if (!validator.consume(
+            offset,
+            forbidden & inBounds,
+            separators & inBounds,
+            nonAscii & inBounds)) {
+      return false;
+    }
+  }
+  return validator.finish();
+}
+#endif
+
+bool validatePath(std::string_view path, PathByteClasses classes) {
+#if FOLLY_X64
+  // Most path components fit in a single 16 byte chunk, for which the wider
+  // registers would only mean copying more padding.
+  if (path.size() > sizeof(__m128i) && kCpuHasAvx2) {
+    return validatePathAvx2(path, classes);
+  }
+  return validatePathSse2(path, classes);
+#else
+  return validatePathScalar(path, classes);
+#endif
+}
+
+} // namespace
+
+bool isValidPathComponent(std::string_view val) noexcept {
+  constexpr PathByteClasses kClasses{
+      {'\0', '\0'},
+      {kDirSeparator, folly::kIsWindows ? kWinDirSeparator : '\0'}};
+  return validatePath(val, kClasses);
+}
+
+bool isValidComposedPath(
+    std::string_view val,
+    std::optional<char> pathSeparator) noexcept {
+  PathByteClasses classes{};
+  if (pathSeparator) {
+    classes.separators[0] = *pathSeparator;
+  } else {
+    classes.separators[0] = kDirSeparator;
+    classes.separators[1] = folly::kIsWindows ? kWinDirSeparator : '\0';
+  }
+
+  // Directory separators that do not delimit components are not allowed
+  // inside of one.
+  size_t forbiddenCount = 0;
+  for (char c : {char{kDirSeparator}, char{kWinDirSeparator}}) {
+    if (isDirSeparator(c) && c != classes.separators[0] &&
+        c != classes.separators[1]) {
+      classes.forbidden[forbiddenCount++] = c;
+    }
+  }
+
+  return validatePath(val, classes);
+}
+
+namespace {
+
+/**
+ * Compares a and b one byte at a time from offset onwards, all bytes before
+ * offset being known to fold to the same values.
+ */
+int compareAsciiCaseInsensitiveScalar(
+    std::string_view a,
+    std::string_view b,
+    size_t offset) {
+  size_t size = std::min(a.size(), b.size());
+  for (size_t i = offset; i < size; ++i) {
+    char lhs = AsciiLessThanCaseInsensitive::toLower(a[i]);
+    char rhs = AsciiLessThanCaseInsensitive::toLower(b[i]);
+    if (lhs != rhs) {
+      return lhs < rhs ? -1 : 1;
+    }
+  }
+  if (a.size() == b.size()) {
+    return 0;
+  }
+  return a.size() < b.size() ? -1 : 1;
+}
+
+#if FOLLY_X64
+/**
+ * The vectorized loops below return the offset of the first byte that differs
+ * after case folding, or the offset past the last whole chunk if there is
+ * none. The scalar loop then takes over from there: it orders the differing
+ * bytes exactly as AsciiLessThanCaseInsensitive does, whatever the signedness
+ * of char.
+ *
+ * Bytes are folded by setting bit 5 of those in the A-Z range. The range check
+ * uses signed comparisons, under which non-ASCII bytes are negative and are
+ * therefore left alone.
+ */
+__m128i foldAsciiCaseSse2(__m128i chunk) {
+  __m128i upper = _mm_and_si128(
+      _mm_cmpgt_epi8(chunk, _mm_set1_epi8('A' - 1)),
+      _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), chunk));
+  return _mm_or_si128(chunk, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+size_t skipEqualAsciiCaseInsensitiveSse2(
+    const char* a,
+    const char* b,
+    size_t offset,
+    size_t size) {
+  constexpr size_t kWidth = sizeof(__m128i);
+  for (; offset + kWidth <= size; offset += kWidth) {
+    __m128i lhs = foldAsciiCaseSse2(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + offset)));
+    __m128i rhs = foldAsciiCaseSse2(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + offset)));
+    uint32_t differ = ~_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) & 0xffff;
+    if (differ != 0) {
+      return offset + std::countr_zero(differ);
+    }
+  }
+  return offset;
+}
+
+EDEN_TARGET_ATTRIBUTE("avx2") __m256i foldAsciiCaseAvx2(__m256i chunk) {
+  __m256i upper = _mm256_and_si256(
+      _mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('A' - 1)),
+      _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), chunk));
+  return _mm256_or_si256(
+      chunk, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+EDEN_TARGET_ATTRIBUTE("avx2") size_t skipEqualAsciiCaseInsensitiveAvx2(
+    const char* a,
+    const char* b,
+    size_t offset,
+    size_t size) {
+  constexpr size_t kWidth = sizeof(__m256i);
+  for (; offset + kWidth <= size; offset += kWidth) {
+    __m256i lhs = foldAsciiCaseAvx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + offset)));
+    __m256i rhs = foldAsciiCaseAvx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + offset)));
+    uint32_t differ = ~static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs)));
+    if (differ != 0) {
+      return offset + std::countr_zero(differ);
+    }
+  }
+  return offset;
+}
+#endif
+
+} // namespace
+
+int compareAsciiCaseInsensitive(
+    std::string_view a,
+    std::string_view b) noexcept {
+  size_t offset = 0;
+#if FOLLY_X64
+  size_t size = std::min(a.size(), b.size());
+  if (size >= sizeof(__m256i) && kCpuHasAvx2) {
+    offset = skipEqualAsciiCaseInsensitiveAvx2(a.data(), b.data(), 0, size);
+  }
+  offset = skipEqualAsciiCaseInsensitiveSse2(a.data(), b.data(), offset, size);
+#endif
+  return compareAsciiCaseInsensitiveScalar(a, b, offset);
+}
+
+} // namespace detail
+
 AbsolutePath getcwd() {
   char cwd[PATH_MAX];
   if (!::getcwd(cwd, sizeof(cwd))) {
@@ -53,8 +401,11 @@ AbsolutePath getcwd() {
 }
 
 namespace {
+// Enough for all but unusually deep paths to be split without allocating.
+using CanonicalComponents = folly::small_vector<std::string_view, 32>;
+
 struct CanonicalData {
-  std::vector<std::string_view> components;
+  CanonicalComponents components;
   bool isAbsolute{false};
 };
 
@@ -62,6 +413,43 @@ bool startsWithUNC(string_view path) {
   return folly::kIsWindows && path.starts_with(detail::kUNCPrefix);
 }
 
+bool isDriveLetter(string_view component) {
+  return component.size() == 2 && std::isalpha(component[0]) &&
+      component[1] == ':';
+}
+
+/**
+ * Returns true if path is one or more valid path components joined by
+ * separator and nothing else: no empty, "." or ".." components and no other
+ * kind of directory separator. canonicalPathData() returns the components of
+ * such a path unchanged, so joining them back with separator reproduces it.
+ */
+bool isNormalized(string_view path, char separator) {
+  return !path.empty() && detail::isValidComposedPath(path, separator);
+}
+
+/**
+ * Returns true if path is already in the form canonicalPath() produces for an
+ * absolute path.
+ */
+bool isCanonicalAbsolute(string_view path) {
+  return path.starts_with(detail::kRootStr) &&
+      isNormalized(path.substr(detail::kRootStr.size()), kAbsDirSeparator);
+}
+
+/**
+ * Returns true if path is relative and already normalized, in which case
+ * canonicalizing it against a canonical base amounts to concatenation.
+ */
+bool isNormalizedRelative(string_view path) {
+  if (!isNormalized(path, kAbsDirSeparator)) {
+    return false;
+  }
+  // canonicalPathData() treats a leading drive letter as absolute.
+  return !folly::kIsWindows ||
+      !isDriveLetter(path.substr(0, path.find(kAbsDirSeparator)));
+}
+
 /**
  * Parse path into a collection of path components such that:
  * - "." (single dot) and "" (empty) components are discarded.
@@ -106,8 +494,7 @@ CanonicalData canonicalPathData(std::string_view path) {
     } else {
       if (folly::kIsWindows && component.begin() == path.begin()) {
         // Drive letter paths are absolute.
-        if (component.size() == 2 && std::isalpha(component[0]) &&
-            component[1] == ':') {
+        if (isDriveLetter(component)) {
           data.isAbsolute = true;
         }
       }
@@ -130,7 +517,7 @@ CanonicalData canonicalPathData(std::string_view path) {
 AbsolutePath canonicalPathImpl(
     std::string_view path,
     std::optional<AbsolutePathPiece> base) {
-  auto makeAbsolutePath = [](const std::vector<std::string_view>& parts) {
+  auto makeAbsolutePath = [](const CanonicalComponents& parts) {
     if (parts.empty()) {
       return AbsolutePath{};
     }
@@ -158,6 +545,39 @@ AbsolutePath canonicalPathImpl(
     return AbsolutePath{std::move(value), detail::SkipPathSanityCheck{}};
   };
 
+  // Most paths are already canonical: return a copy without splitting and
+  // re-joining them.
+  if (isCanonicalAbsolute(path)) {
+    return AbsolutePath{std::string{path}, detail::SkipPathSanityCheck{}};
+  }
+
+  // canonicalPathData() returns std::string_views pointing to the input,
+  // so we have to store the cwd in a variable that will persist until the
+  // end of this function.
+  AbsolutePath cwd;
+  auto getBase = [&]() -> AbsolutePathPiece {
+    if (!base.has_value()) {
+      cwd = getcwd();
+      base = cwd.piece();
+    }
+    return *base;
+  };
+
+  // A normalized relative path only needs to be appended to a canonical base.
+  if (isNormalizedRelative(path)) {
+    auto baseView = getBase().view();
+    if (detail::isAbsoluteRoot(baseView) || isCanonicalAbsolute(baseView)) {
+      std::string value;
+      value.reserve(baseView.size() + 1 + path.size());
+      value.append(baseView);
+      if (!detail::isAbsoluteRoot(baseView)) {
+        value.push_back(kAbsDirSeparator);
+      }
+      value.append(path);
+      return AbsolutePath{std::move(value), detail::SkipPathSanityCheck{}};
+    }
+  }
+
   auto canon = canonicalPathData(path);
   if (canon.isAbsolute) {
     return makeAbsolutePath(canon.components);
@@ -166,17 +586,7 @@ AbsolutePath canonicalPathImpl(
   // Get the components from the base path
   // For simplicity we are just reusing canonicalPathData() even though the
   // base path is guaranteed to already be in canonical form.
-  CanonicalData baseCanon;
-  AbsolutePath cwd;
-  if (!base.has_value()) {
-    // canonicalPathData() returns std::string_views pointing to the input,
-    // so we have to store the cwd in a variable that will persist until the
-    // end of this function.
-    cwd = getcwd();
-    baseCanon = canonicalPathData(cwd.view());
-  } else {
-    baseCanon = canonicalPathData(base.value().view());
-  }
+  auto baseCanon = canonicalPathData(getBase().view());
 
   for (auto it = canon.components.begin(); it != canon.components.end(); ++it) {
     // There may be leading ".." parts, so we have to deal with them here
@@ -213,6 +623,23 @@ folly::Expected<RelativePath, int> joinAndNormalize(
   if (path.starts_with(kDirSeparator)) {
     return folly::makeUnexpected(EPERM);
   }
+
+  // If both halves are already normalized, so is their concatenation, and it
+  // only takes a single allocation.
+  auto baseView = base.view();
+  if ((path.empty() || isNormalized(path, kDirSeparator)) &&
+      (baseView.empty() || isNormalized(baseView, kDirSeparator))) {
+    std::string value;
+    value.reserve(baseView.size() + 1 + path.size());
+    value.append(baseView);
+    if (!baseView.empty() && !path.empty()) {
+      value.append(kDirSeparatorStr);
+    }
+    value.append(path);
+    return folly::makeExpected<int>(
+        RelativePath{std::move(value), detail::SkipPathSanityCheck{}});
+  }
+
   const std::string joined = base.value().empty() ? std::string{path}
       : path.empty()                              ? std::string{base.value()}
                      : fmt::format("{}{}{}", base, kDirSeparatorStr, path);
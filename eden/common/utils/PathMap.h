@@ -11,6 +11,8 @@
 #include <algorithm>
 #include <functional>
 #include <iterator>
+#include <stdexcept>
+#include <type_traits>
 #include <utility>
 
 #include "eden/common/utils/CaseSensitivity.h"
@@ -32,11 +34,17 @@ namespace facebook::eden {
  *   it is better to pre-sort the data to be inserted.
  * - Since insert and erase operations move the vector contents around,
  *   those operations invalidate iterators.
+ *
+ * Storage is the underlying vector type; see SmallPathMap.h for a variant
+ * that keeps small maps inline.
  */
-template <typename Value, typename Key = PathComponent>
-class PathMap : private folly::fbvector<std::pair<Key, Value>> {
+template <
+    typename Value,
+    typename Key = PathComponent,
+    typename Storage = folly::fbvector<std::pair<Key, Value>>>
+class PathMap : private Storage {
   using Pair = std::pair<Key, Value>;
-  using Vector = folly::fbvector<Pair>;
+  using Vector = Storage;
   using Piece = typename Key::piece_type;
   using Allocator = typename Vector::allocator_type;
 
@@ -160,8 +168,7 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
 
       // Unique out the duplicates.
       auto last = std::unique(vec.begin(), vec.end(), [=](auto& a, auto& b) {
-        // NB: assumes Key is PathComponent (but so does Compare).
-        return isPathPieceEqual(a.first, b.first, caseSensitive);
+        return isPathPieceEqual(Piece(a.first), Piece(b.first), caseSensitive);
       });
       vec.erase(last, vec.end());
     }
@@ -343,36 +350,183 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
     return iter != end();
   }
 
+  /** Insert a batch of key-value pairs in a single linear pass.
+   *
+   * `batch` is a forward range of value_type that must already be sorted
+   * according to this map's CaseSensitivity; std::invalid_argument is thrown
+   * (and the map left unchanged) if it isn't. Keys that are already present
+   * are left unaltered, and of several equal keys in the batch only the
+   * earliest is inserted, matching a sequence of insert() calls and the
+   * Vector&& constructor. If `batch` is an rvalue, its entries are moved from.
+   *
+   * If copying or moving an entry throws, the map is left unchanged,
+   * although entries of an rvalue `batch` may already have been moved from.
+   * As with insert(), existing entries whose move constructor may throw are
+   * copied instead, so the guarantee is lost only if they can't be copied.
+   *
+   * This is O(n + k) rather than the O(k * n) of k out-of-order inserts.
+   * Returns the number of entries that were inserted. */
+  template <typename Range>
+  size_type mergeSorted(Range&& batch) {
+    auto first = std::begin(batch);
+    auto last = std::end(batch);
+    static_assert(
+        std::is_same_v<std::remove_cvref_t<decltype(*first)>, value_type>,
+        "mergeSorted() takes a range of value_type");
+    checkSorted(first, last, [](const auto& entry) -> const auto& {
+      return entry.first;
+    });
+
+    auto take = [](auto& entry) -> decltype(auto) {
+      if constexpr (std::is_rvalue_reference_v<Range&&>) {
+        return std::move(entry);
+      } else {
+        return std::as_const(entry);
+      }
+    };
+
+    Vector& vec = *this;
+    auto sizeBefore = vec.size();
+    // Appending past the current last key doesn't need to move anything.
+    if (vec.empty() || first == last ||
+        compare_(vec.back().first, first->first)) {
+      try {
+        for (; first != last; ++first) {
+          if (vec.size() == sizeBefore ||
+              compare_(vec.back().first, first->first)) {
+            vec.push_back(take(*first));
+          }
+        }
+      } catch (...) {
+        vec.erase(vec.begin() + sizeBefore, vec.end());
+        throw;
+      }
+      return vec.size() - sizeBefore;
+    }
+
+    // Take the new entries out of the batch before touching the map.
+    Vector added;
+    auto existing = vec.begin();
+    for (; first != last; ++first) {
+      while (existing != vec.end() && compare_(existing->first, first->first)) {
+        ++existing;
+      }
+      // Present keys, and repeats in the batch: the earliest wins.
+      if ((existing != vec.end() && !compare_(first->first, existing->first)) ||
+          (!added.empty() && !compare_(added.back().first, first->first))) {
+        continue;
+      }
+      added.push_back(take(*first));
+    }
+    if (added.empty()) {
+      return 0;
+    }
+
+    // Like insert(), only move existing entries if that can't throw.
+    Vector merged;
+    merged.reserve(sizeBefore + added.size());
+    auto next = added.begin();
+    for (auto& entry : vec) {
+      while (next != added.end() && compare_(next->first, entry.first)) {
+        merged.push_back(std::move(*next));
+        ++next;
+      }
+      merged.push_back(std::move_if_noexcept(entry));
+    }
+    for (; next != added.end(); ++next) {
+      merged.push_back(std::move(*next));
+    }
+    vec.swap(merged);
+    return vec.size() - sizeBefore;
+  }
+
+  /** Erase a batch of keys in a single linear pass.
+   *
+   * `keys` is a forward range of values convertible to Piece that must
+   * already be sorted according to this map's CaseSensitivity;
+   * std::invalid_argument is thrown (and the map left unchanged) if it
+   * isn't. Keys that aren't present are ignored.
+   *
+   * This is O(n + k) rather than the O(k * n) of k erase() calls.
+   * Returns the number of entries that were erased. */
+  template <typename Range>
+  size_type eraseSorted(const Range& keys) {
+    auto first = std::begin(keys);
+    auto last = std::end(keys);
+    checkSorted(
+        first, last, [](const auto& key) -> const auto& { return key; });
+
+    Vector& vec = *this;
+    auto out = vec.begin();
+    for (auto in = vec.begin(); in != vec.end(); ++in) {
+      while (first != last && compare_(*first, in->first)) {
+        ++first;
+      }
+      if (first != last && !compare_(in->first, *first)) {
+        continue;
+      }
+      if (out != in) {
+        *out = std::move(*in);
+      }
+      ++out;
+    }
+    auto erased = static_cast<size_type>(vec.end() - out);
+    vec.erase(out, vec.end());
+    return erased;
+  }
+
   CaseSensitivity getCaseSensitivity() const {
     return compare_.caseSensitive_;
   }
 
   /// Equality operator.
-  template <typename V, typename K>
-  friend bool operator==(const PathMap<V, K>& lhs, const PathMap<V, K>& rhs);
+  template <typename V, typename K, typename S>
+  friend bool operator==(
+      const PathMap<V, K, S>& lhs,
+      const PathMap<V, K, S>& rhs);
 
   /// Inequality operator.
-  template <typename V, typename K>
-  friend bool operator!=(const PathMap<V, K>& lhs, const PathMap<V, K>& rhs);
+  template <typename V, typename K, typename S>
+  friend bool operator!=(
+      const PathMap<V, K, S>& lhs,
+      const PathMap<V, K, S>& rhs);
+
+ private:
+  // Throws std::invalid_argument unless the keys of [first, last) are in
+  // non-decreasing order.
+  template <typename Iterator, typename GetKey>
+  void checkSorted(Iterator first, Iterator last, GetKey getKey) const {
+    if (first == last) {
+      return;
+    }
+    for (auto prev = first++; first != last; prev = first++) {
+      if (compare_(getKey(*first), getKey(*prev))) {
+        throwf<std::invalid_argument>(
+            "batch is not sorted: {} follows {}",
+            Piece(getKey(*first)),
+            Piece(getKey(*prev)));
+      }
+    }
+  }
 };
 
 // Implementations of the equality operators; gcc hates us if we
 // define them inline in the class above.
 
 /// Equality operator.
-template <typename V, typename K>
-bool operator==(const PathMap<V, K>& lhs, const PathMap<V, K>& rhs) {
+template <typename V, typename K, typename S>
+bool operator==(const PathMap<V, K, S>& lhs, const PathMap<V, K, S>& rhs) {
   // reinterpret lhs as the underlying vector type.
-  const folly::fbvector<std::pair<K, V>>& vector = lhs;
-  return vector == rhs;
+  const S& vector = lhs;
+  return vector == static_cast<const S&>(rhs);
 }
 
 /// Inequality operator.
-template <typename V, typename K>
-bool operator!=(const PathMap<V, K>& lhs, const PathMap<V, K>& rhs) {
+template <typename V, typename K, typename S>
+bool operator!=(const PathMap<V, K, S>& lhs, const PathMap<V, K, S>& rhs) {
   // reinterpret lhs as the underlying vector type.
-  const folly::fbvector<std::pair<K, V>>& vector = lhs;
-  return vector != rhs;
+  const S& vector = lhs;
+  return vector != static_cast<const S&>(rhs);
 }
 
 /**
@@ -397,14 +551,17 @@ PathMap<std::pair<std::optional<A>, std::optional<B>>, P> collatePathMaps(
   auto result = PathMap<std::pair<std::optional<A>, std::optional<B>>, P>{
       {}, caseSensitivity};
 
+  using Piece = typename P::piece_type;
   auto aIt = a.begin();
   auto bIt = b.begin();
   while (aIt != a.end() && bIt != b.end()) {
-    if (isPathPieceEqual(aIt->first, bIt->first, caseSensitivity)) {
+    Piece aKey{aIt->first};
+    Piece bKey{bIt->first};
+    if (isPathPieceEqual(aKey, bKey, caseSensitivity)) {
       result.emplace(aIt->first, std::make_pair(aIt->second, bIt->second));
       ++aIt;
       ++bIt;
-    } else if (isPathPieceLess(aIt->first, bIt->first, caseSensitivity)) {
+    } else if (isPathPieceLess(aKey, bKey, caseSensitivity)) {
       result.emplace(aIt->first, std::make_pair(aIt->second, std::nullopt));
       ++aIt;
     } else {
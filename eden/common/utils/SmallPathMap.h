@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <folly/small_vector.h>
+#include <cstddef>
+#include <utility>
+
+#include "eden/common/utils/PathMap.h"
+
+namespace facebook::eden {
+
+/**
+ * A PathMap that stores up to N entries inline, without any heap allocation.
+ *
+ * Most directories hold only a handful of entries, and a process holding
+ * millions of trees pays for one malloc per PathMap just for the vector
+ * storage. SmallPathMap behaves exactly like PathMap, and only spills its
+ * entries to the heap once there are more than N of them.
+ *
+ * The map is N * sizeof(std::pair<Key, Value>) plus 16 bytes: the vector's
+ * size word and the CaseSensitivity, which is a single byte.
+ */
+template <typename Value, size_t N = 8, typename Key = PathComponent>
+using SmallPathMap =
+    PathMap<Value, Key, folly::small_vector<std::pair<Key, Value>, N>>;
+
+} // namespace facebook::eden
@@ -9,8 +9,278 @@
 
 #include <folly/Unicode.h>
 
+#include <cstring>
+
+#include "eden/common/utils/CpuFeatures.h"
+
+#if FOLLY_X64
+#include <immintrin.h>
+#endif
+
 namespace facebook::eden {
 
+namespace detail {
+namespace {
+
+#if FOLLY_X64
+// Error classes of a pair of consecutive bytes. Each table below maps a
+// nibble of one of the two bytes to the classes it is compatible with, so
+// the AND of the three lookups is non-zero only for an invalid pair.
+constexpr uint8_t kTooShort = 1 << 0; // 11______ 0_______
+                                      // 11______ 11______
+constexpr uint8_t kTooLong = 1 << 1; // 0_______ 10______
+constexpr uint8_t kOverlong3 = 1 << 2; // 11100000 100_____
+constexpr uint8_t kLeadTooLong = 1 << 3; // 11111___ ________
+constexpr uint8_t kOverlong2 = 1 << 5; // 1100000_ 10______
+constexpr uint8_t kOverlong4 = 1 << 6; // 11110000 1000____
+constexpr uint8_t kTwoContinuations = 1 << 7; // 10______ 10______
+constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoContinuations;
+
+// Indexed by the high nibble of the first byte.
+alignas(16) constexpr uint8_t kFirstHighTable[16] = {
+    // 0_______ ASCII
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    // 10______ continuation
+    kTwoContinuations,
+    kTwoContinuations,
+    kTwoContinuations,
+    kTwoContinuations,
+    // 1100____ 2 byte lead
+    kTooShort | kOverlong2,
+    // 1101____ 2 byte lead
+    kTooShort,
+    // 1110____ 3 byte lead
+    kTooShort | kOverlong3,
+    // 1111____ 4 byte lead, or invalid
+    kTooShort | kOverlong4 | kLeadTooLong,
+};
+
+// Indexed by the low nibble of the first byte.
+alignas(16) constexpr uint8_t kFirstLowTable[16] = {
+    // ____0000
+    kCarry | kOverlong2 | kOverlong3 | kOverlong4,
+    // ____0001
+    kCarry | kOverlong2,
+    // ____001_
+    kCarry,
+    kCarry,
+    // ____01__
+    kCarry,
+    kCarry,
+    kCarry,
+    kCarry,
+    // ____1___
+    kCarry | kLeadTooLong,
+    kCarry | kLeadTooLong,
+    kCarry | kLeadTooLong,
+    kCarry | kLeadTooLong,
+    kCarry | kLeadTooLong,
+    kCarry | kLeadTooLong,
+    kCarry | kLeadTooLong,
+    kCarry | kLeadTooLong,
+};
+
+// Indexed by the high nibble of the second byte.
+alignas(16) constexpr uint8_t kSecondHighTable[16] = {
+    // 0_______ ASCII
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    // 1000____
+    kTooLong | kOverlong2 | kTwoContinuations | kOverlong3 | kOverlong4 |
+        kLeadTooLong,
+    // 1001____
+    kTooLong | kOverlong2 | kTwoContinuations | kOverlong3 | kLeadTooLong,
+    // 101_____
+    kTooLong | kOverlong2 | kTwoContinuations | kLeadTooLong,
+    kTooLong | kOverlong2 | kTwoContinuations | kLeadTooLong,
+    // 11______ lead
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+    kTooShort | kLeadTooLong,
+};
+
+// A chunk whose last three bytes exceed these values ends in the middle of a
+// multi-byte sequence: 1111____ 111_____ 11______.
+alignas(32) constexpr uint8_t kIncompleteMax[32] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf,
+};
+
+EDEN_TARGET_ATTRIBUTE("ssse3") bool isValidUtf8Ssse3(folly::StringPiece str) {
+  constexpr size_t kWidth = sizeof(__m128i);
+  const __m128i firstHighTable =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kFirstHighTable));
+  const __m128i firstLowTable =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kFirstLowTable));
+  const __m128i secondHighTable =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kSecondHighTable));
+  const __m128i incompleteMax = _mm_load_si128(
+      reinterpret_cast<const __m128i*>(kIncompleteMax + kWidth));
+  const __m128i lowNibble = _mm_set1_epi8(0x0f);
+  const __m128i zero = _mm_setzero_si128();
+
+  __m128i error = zero;
+  __m128i previous = zero;
+  __m128i previousIncomplete = zero;
+  for (size_t offset = 0; offset < str.size(); offset += kWidth) {
+    __m128i input;
+    if (str.size() - offset >= kWidth) {
+      input = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(str.data() + offset));
+    } else {
+      // Pad the tail with nul bytes, which are ASCII.
+      alignas(kWidth) char tail[kWidth] = {};
+      std::memcpy(tail, str.data() + offset, str.size() - offset);
+      input = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+    }
+
+    if (_mm_movemask_epi8(input) == 0) {
+      // All ASCII: the only possible error is a sequence left unterminated
+      // by the previous chunk.
+      error = _mm_or_si128(error, previousIncomplete);
+      previousIncomplete = zero;
+    } else {
+      __m128i prev1 = _mm_alignr_epi8(input, previous, kWidth - 1);
+      __m128i firstHigh = _mm_shuffle_epi8(
+          firstHighTable, _mm_and_si128(_mm_srli_epi16(prev1, 4), lowNibble));
+      __m128i firstLow =
+          _mm_shuffle_epi8(firstLowTable, _mm_and_si128(prev1, lowNibble));
+      __m128i secondHigh = _mm_shuffle_epi8(
+          secondHighTable, _mm_and_si128(_mm_srli_epi16(input, 4), lowNibble));
+      __m128i special =
+          _mm_and_si128(_mm_and_si128(firstHigh, firstLow), secondHigh);
+
+      // The second and third bytes after a 3 or 4 byte lead must be
+      // continuations, which the pair check classifies as kTwoContinuations.
+      __m128i prev2 = _mm_alignr_epi8(input, previous, kWidth - 2);
+      __m128i prev3 = _mm_alignr_epi8(input, previous, kWidth - 3);
+      __m128i mustContinue = _mm_and_si128(
+          _mm_or_si128(
+              _mm_subs_epu8(prev2, _mm_set1_epi8(0xe0 - 0x80)),
+              _mm_subs_epu8(prev3, _mm_set1_epi8(0xf0 - 0x80))),
+          _mm_set1_epi8(static_cast<char>(0x80)));
+      error = _mm_or_si128(error, _mm_xor_si128(mustContinue, special));
+
+      previousIncomplete = _mm_subs_epu8(input, incompleteMax);
+    }
+    previous = input;
+  }
+  error = _mm_or_si128(error, previousIncomplete);
+
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) == 0xffff;
+}
+
+EDEN_TARGET_ATTRIBUTE("avx2") bool isValidUtf8Avx2(folly::StringPiece str) {
+  constexpr size_t kWidth = sizeof(__m256i);
+  const __m256i firstHighTable = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kFirstHighTable)));
+  const __m256i firstLowTable = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kFirstLowTable)));
+  const __m256i secondHighTable = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kSecondHighTable)));
+  const __m256i incompleteMax =
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(kIncompleteMax));
+  const __m256i lowNibble = _mm256_set1_epi8(0x0f);
+  const __m256i zero = _mm256_setzero_si256();
+
+  __m256i error = zero;
+  __m256i previous = zero;
+  __m256i previousIncomplete = zero;
+  for (size_t offset = 0; offset < str.size(); offset += kWidth) {
+    __m256i input;
+    if (str.size() - offset >= kWidth) {
+      input = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(str.data() + offset));
+    } else {
+      alignas(kWidth) char tail[kWidth] = {};
+      std::memcpy(tail, str.data() + offset, str.size() - offset);
+      input = _mm256_load_si256(reinterpret_cast<const __m256i*>(tail));
+    }
+
+    if (_mm256_movemask_epi8(input) == 0) {
+      error = _mm256_or_si256(error, previousIncomplete);
+      previousIncomplete = zero;
+    } else {
+      // Shuffles and byte shifts operate on 128 bit lanes: line the upper
+      // half of the previous chunk up with the lower half of this one.
+      __m256i shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+      __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+      __m256i firstHigh = _mm256_shuffle_epi8(
+          firstHighTable,
+          _mm256_and_si256(_mm256_srli_epi16(prev1, 4), lowNibble));
+      __m256i firstLow = _mm256_shuffle_epi8(
+          firstLowTable, _mm256_and_si256(prev1, lowNibble));
+      __m256i secondHigh = _mm256_shuffle_epi8(
+          secondHighTable,
+          _mm256_and_si256(_mm256_srli_epi16(input, 4), lowNibble));
+      __m256i special =
+          _mm256_and_si256(_mm256_and_si256(firstHigh, firstLow), secondHigh);
+
+      __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+      __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+      __m256i mustContinue = _mm256_and_si256(
+          _mm256_or_si256(
+              _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+              _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80))),
+          _mm256_set1_epi8(static_cast<char>(0x80)));
+      error = _mm256_or_si256(error, _mm256_xor_si256(mustContinue, special));
+
+      previousIncomplete = _mm256_subs_epu8(input, incompleteMax);
+    }
+    previous = input;
+  }
+  error = _mm256_or_si256(error, previousIncomplete);
+
+  return _mm256_testz_si256(error, error) != 0;
+}
+#endif
+
+bool isValidUtf8Scalar(folly::StringPiece str) {
+  // Skip over leading ASCII a word at a time before decoding byte by byte.
+  const char* begin = str.begin();
+  const char* const end = str.end();
+  while (end - begin >= static_cast<ptrdiff_t>(sizeof(uint64_t))) {
+    uint64_t word;
+    std::memcpy(&word, begin, sizeof(word));
+    if ((word & 0x8080808080808080) != 0) {
+      break;
+    }
+    begin += sizeof(word);
+  }
+  return isValidUtf8Constexpr(folly::StringPiece{begin, end});
+}
+
+} // namespace
+
+bool isValidUtf8Runtime(folly::StringPiece str) noexcept {
+#if FOLLY_X64
+  if (str.size() > sizeof(__m128i) && kCpuHasAvx2) {
+    return isValidUtf8Avx2(str);
+  }
+  if (kCpuHasSsse3) {
+    return isValidUtf8Ssse3(str);
+  }
+#endif
+  return isValidUtf8Scalar(str);
+}
+
+} // namespace detail
+
 std::string ensureValidUtf8(folly::ByteRange str) {
   std::string output;
   output.reserve(str.size());
@@ -9,6 +9,7 @@
 
 #include <folly/Range.h>
 #include <folly/Utility.h>
+#include <type_traits>
 
 namespace facebook::eden {
 
@@ -43,7 +44,7 @@ constexpr bool isValidContinuation(
     const char* const end,
     size_t num,
     uint32_t& codepoint) {
-  if (begin + num - 1 > end) {
+  if (static_cast<size_t>(end - begin) < num) {
     return false;
   }
 
@@ -57,29 +58,25 @@ constexpr bool isValidContinuation(
 
   return true;
 }
-} // namespace detail
 
 /**
- * Returns whether the given string is correctly-encoded UTF-8.
- *
- * This doesn't verify whether the codepoints are actually valid unicode
- * characters.
+ * Scalar implementation of isValidUtf8, usable in constant expressions.
  */
-constexpr bool isValidUtf8(folly::StringPiece str) {
+constexpr bool isValidUtf8Constexpr(folly::StringPiece str) {
   const char* begin = str.begin();
   const char* const end = str.end();
 
   while (begin != end) {
     char first = *begin++;
-    if (!detail::isBitSet(first, 7)) {
+    if (!isBitSet(first, 7)) {
       // ASCII character, nothing to do.
-    } else if (!detail::isBitSet(first, 6)) {
+    } else if (!isBitSet(first, 6)) {
       // 10xxxxxx isn't a valid for the first byte.
       return false;
-    } else if (!detail::isBitSet(first, 5)) {
+    } else if (!isBitSet(first, 5)) {
       // 110xxxxx: 2 bytes
       uint32_t codepoint = folly::to_unsigned(first) & 0x1F;
-      if (!detail::isValidContinuation(begin, end, 1, codepoint)) {
+      if (!isValidContinuation(begin, end, 1, codepoint)) {
         return false;
       }
 
@@ -87,10 +84,10 @@ constexpr bool isValidUtf8(folly::StringPiece str) {
       if (codepoint < 0x80) {
         return false;
       }
-    } else if (!detail::isBitSet(first, 4)) {
+    } else if (!isBitSet(first, 4)) {
       // 1110xxxx: 3 bytes
       uint32_t codepoint = folly::to_unsigned(first) & 0xF;
-      if (!detail::isValidContinuation(begin, end, 2, codepoint)) {
+      if (!isValidContinuation(begin, end, 2, codepoint)) {
         return false;
       }
 
@@ -98,10 +95,10 @@ constexpr bool isValidUtf8(folly::StringPiece str) {
       if (codepoint < 0x800) {
         return false;
       }
-    } else if (!detail::isBitSet(first, 3)) {
+    } else if (!isBitSet(first, 3)) {
       // 11110xxx: 4 bytes
       uint32_t codepoint = folly::to_unsigned(first) & 0x7;
-      if (!detail::isValidContinuation(begin, end, 3, codepoint)) {
+      if (!isValidContinuation(begin, end, 3, codepoint)) {
         return false;
       }
 
@@ -118,6 +115,31 @@ constexpr bool isValidUtf8(folly::StringPiece str) {
   return true;
 }
 
+/**
+ * Vectorized implementation of isValidUtf8 for use at runtime.
+ *
+ * It validates 16 or 32 bytes per step with the lookup table algorithm from
+ * "Validating UTF-8 In Less Than One Instruction Per Byte" (Keiser & Lemire),
+ * and skips over chunks that are entirely ASCII. The tables are adjusted to
+ * accept exactly what isValidUtf8Constexpr accepts: surrogates and 4 byte
+ * sequences above U+10FFFF are not rejected.
+ */
+bool isValidUtf8Runtime(folly::StringPiece str) noexcept;
+} // namespace detail
+
+/**
+ * Returns whether the given string is correctly-encoded UTF-8.
+ *
+ * This doesn't verify whether the codepoints are actually valid unicode
+ * characters.
+ */
+constexpr bool isValidUtf8(folly::StringPiece str) {
+  if (std::is_constant_evaluated()) {
+    return detail::isValidUtf8Constexpr(str);
+  }
+  return detail::isValidUtf8Runtime(str);
+}
+
 std::string ensureValidUtf8(folly::ByteRange str);
 
 /**
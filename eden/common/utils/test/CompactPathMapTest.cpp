@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/CompactPathMap.h"
+
+#include <fmt/format.h>
+#include <folly/portability/GTest.h>
+#include <string>
+#include <vector>
+
+using namespace facebook::eden;
+using namespace facebook::eden::path_literals;
+
+namespace {
+
+using Map = CompactPathMap<int>;
+using Encoding = Map::KeyEncoding;
+
+class CompactPathMapTest : public ::testing::TestWithParam<Encoding> {};
+
+Map::Vector makeEntries(size_t count) {
+  Map::Vector entries;
+  for (size_t i = 0; i < count; ++i) {
+    // Build names out of order and with long shared prefixes.
+    auto n = (i * 7919) % count;
+    entries.emplace_back(
+        PathComponent{fmt::format("some_long_module_name_{:05}.cpp", n)},
+        static_cast<int>(n));
+  }
+  return entries;
+}
+
+} // namespace
+
+TEST_P(CompactPathMapTest, empty) {
+  Map map{Map::Vector{}, CaseSensitivity::Sensitive, GetParam()};
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.begin(), map.end());
+  EXPECT_EQ(map.end(), map.find("foo"_pc));
+  EXPECT_THROW(map.at("foo"_pc), std::out_of_range);
+}
+
+TEST_P(CompactPathMapTest, findAndIterate) {
+  constexpr size_t kCount = 1000;
+  Map map{makeEntries(kCount), CaseSensitivity::Sensitive, GetParam()};
+  ASSERT_EQ(kCount, map.size());
+
+  size_t i = 0;
+  for (auto [name, value] : map) {
+    EXPECT_EQ(fmt::format("some_long_module_name_{:05}.cpp", i), name.view());
+    EXPECT_EQ(static_cast<int>(i), value);
+    ++i;
+  }
+  EXPECT_EQ(kCount, i);
+
+  for (i = 0; i < kCount; ++i) {
+    auto name = fmt::format("some_long_module_name_{:05}.cpp", i);
+    auto it = map.find(PathComponentPiece{name});
+    ASSERT_NE(map.end(), it) << name;
+    EXPECT_EQ(name, it->first.view());
+    EXPECT_EQ(static_cast<int>(i), it->second);
+
+    // Iteration continues correctly from a found entry.
+    if (++it != map.end()) {
+      EXPECT_EQ(
+          fmt::format("some_long_module_name_{:05}.cpp", i + 1),
+          it.key().view());
+    }
+  }
+
+  EXPECT_EQ(0, map.count("some_long_module_name_.cpp"_pc));
+  EXPECT_EQ(0, map.count("a"_pc));
+  EXPECT_EQ(0, map.count("z"_pc));
+  EXPECT_EQ(0, map.count("some_long_module_name_00001.cp"_pc));
+  EXPECT_EQ(0, map.count("some_long_module_name_00001.cppp"_pc));
+}
+
+TEST_P(CompactPathMapTest, caseInsensitive) {
+  Map::Vector entries;
+  entries.emplace_back(PathComponent{"b"}, 1);
+  entries.emplace_back(PathComponent{"a"}, 2);
+  entries.emplace_back(PathComponent{"B"}, 3);
+  entries.emplace_back(PathComponent{"C"}, 4);
+  Map map{std::move(entries), CaseSensitivity::Insensitive, GetParam()};
+
+  // The earliest entry wins, as with PathMap.
+  EXPECT_EQ(3, map.size());
+  EXPECT_EQ(2, map.at("A"_pc));
+  EXPECT_EQ(1, map.at("B"_pc));
+  EXPECT_EQ("b"_pc, map.find("B"_pc).key());
+  EXPECT_EQ(4, map.at("c"_pc));
+  EXPECT_EQ(CaseSensitivity::Insensitive, map.getCaseSensitivity());
+}
+
+TEST_P(CompactPathMapTest, matchesPathMap) {
+  PathMap<int> pathMap{makeEntries(100), CaseSensitivity::Sensitive};
+  PathMap<int> copy{pathMap};
+  Map map{std::move(copy), GetParam()};
+
+  ASSERT_EQ(pathMap.size(), map.size());
+  auto it = map.begin();
+  for (const auto& [name, value] : pathMap) {
+    EXPECT_EQ(name, it->first);
+    EXPECT_EQ(value, it->second);
+    ++it;
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    CompactPathMapTest,
+    CompactPathMapTest,
+    ::testing::Values(Encoding::Plain, Encoding::FrontCoded));
+
+TEST(CompactPathMap, frontCodingSharesPrefixes) {
+  Map plain{makeEntries(256), CaseSensitivity::Sensitive, Encoding::Plain};
+  Map frontCoded{
+      makeEntries(256), CaseSensitivity::Sensitive, Encoding::FrontCoded};
+  EXPECT_EQ(plain, frontCoded);
+  EXPECT_LT(frontCoded.getNameBytes() * 3, plain.getNameBytes());
+}
+
+TEST(CompactPathMap, frontCodingLongNames) {
+  // Names too long for the iterator's buffer are stored whole, and may be
+  // followed by short names sharing their prefix.
+  Map::Vector entries;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < 20; ++i) {
+    names.push_back(fmt::format("{:03}{}", i, std::string(300, 'x')));
+    names.push_back(fmt::format("{:03}y1", i));
+    names.push_back(fmt::format("{:03}y2", i));
+  }
+  for (size_t i = 0; i < names.size(); ++i) {
+    entries.emplace_back(PathComponent{names[i]}, static_cast<int>(i));
+  }
+  Map plain{Map::Vector{entries}, CaseSensitivity::Sensitive, Encoding::Plain};
+  Map frontCoded{
+      std::move(entries), CaseSensitivity::Sensitive, Encoding::FrontCoded};
+  EXPECT_EQ(plain, frontCoded);
+  for (size_t i = 0; i < names.size(); ++i) {
+    EXPECT_EQ(static_cast<int>(i), frontCoded.at(PathComponentPiece{names[i]}));
+  }
+}
@@ -7,6 +7,8 @@
 
 #include "eden/common/utils/CoverageSet.h"
 #include <folly/portability/GTest.h>
+#include <utility>
+#include <vector>
 
 using namespace facebook::eden;
 
@@ -95,3 +97,18 @@ TEST(CoverageSetTest, merge_can_replace_many_nodes) {
   EXPECT_FALSE(s.covers(7, 9));
   EXPECT_TRUE(s.covers(1, 8));
 }
+
+TEST(CoverageSetTest, forEachInterval_visits_merged_intervals_in_order) {
+  CoverageSet s;
+  s.add(10, 12);
+  s.add(1, 2);
+  s.add(2, 4);
+  s.add(6, 7);
+
+  std::vector<std::pair<size_t, size_t>> intervals;
+  s.forEachInterval(
+      [&](size_t begin, size_t end) { intervals.emplace_back(begin, end); });
+  EXPECT_EQ(
+      (std::vector<std::pair<size_t, size_t>>{{1, 4}, {6, 7}, {10, 12}}),
+      intervals);
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/HashIndexedPathMap.h"
+
+#include <fmt/format.h>
+#include <folly/portability/GTest.h>
+#include <random>
+#include <vector>
+
+using namespace facebook::eden;
+using namespace facebook::eden::path_literals;
+
+TEST(HashIndexedPathMap, indexIsBuiltAtThreshold) {
+  HashIndexedPathMap<int> map(CaseSensitivity::Sensitive, 3);
+  map["a"_pc] = 1;
+  map["b"_pc] = 2;
+  EXPECT_FALSE(map.isIndexed());
+  map["c"_pc] = 3;
+  EXPECT_TRUE(map.isIndexed());
+
+  EXPECT_EQ(1, map.at("a"_pc));
+  EXPECT_EQ(2, map.at("b"_pc));
+  EXPECT_EQ(3, map.at("c"_pc));
+  EXPECT_EQ(map.end(), map.find("A"_pc));
+  EXPECT_THROW(map.at("d"_pc), std::out_of_range);
+}
+
+TEST(HashIndexedPathMap, caseInsensitive) {
+  HashIndexedPathMap<bool> map(CaseSensitivity::Insensitive, 1);
+  EXPECT_TRUE(map.emplace("foo"_pc, true).second);
+  EXPECT_TRUE(map.isIndexed());
+
+  EXPECT_TRUE(map.at("FOO"_pc));
+  EXPECT_FALSE(map.insert(std::make_pair(PathComponent("Foo"), false)).second);
+  EXPECT_EQ(1, map.size());
+
+  map["FOO"_pc] = false;
+  EXPECT_EQ(1, map.size());
+  EXPECT_FALSE(map.at("foo"_pc));
+  // The assignment above didn't change the case of the key!
+  EXPECT_EQ(map.begin()->first, "foo"_pc);
+
+  EXPECT_EQ(1, map.erase("fOO"_pc));
+  EXPECT_TRUE(map.empty());
+}
+
+TEST(HashIndexedPathMap, iterationIsSorted) {
+  HashIndexedPathMap<int> map(CaseSensitivity::Sensitive, 2);
+  for (auto name : {"d"_pc, "b"_pc, "e"_pc, "a"_pc, "c"_pc}) {
+    map[name] = 1;
+  }
+  std::vector<std::string> names;
+  for (const auto& [name, value] : map) {
+    names.push_back(name.asString());
+  }
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c", "d", "e"}), names);
+}
+
+TEST(HashIndexedPathMap, vecConstructorKeepsEarliestEntry) {
+  folly::fbvector<std::pair<PathComponent, int>> entries;
+  entries.emplace_back(PathComponent{"b"}, 1);
+  entries.emplace_back(PathComponent{"a"}, 2);
+  entries.emplace_back(PathComponent{"B"}, 3);
+  HashIndexedPathMap<int> map(
+      std::move(entries), CaseSensitivity::Insensitive, 1);
+
+  EXPECT_TRUE(map.isIndexed());
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ(2, map.at("A"_pc));
+  EXPECT_EQ(1, map.at("B"_pc));
+  EXPECT_EQ("b"_pc, map.find("B"_pc)->first);
+}
+
+TEST(HashIndexedPathMap, copyAndMoveKeepIndex) {
+  HashIndexedPathMap<int> map(CaseSensitivity::Sensitive, 1);
+  map["foo"_pc] = 1;
+  map["bar"_pc] = 2;
+
+  auto copied = map;
+  EXPECT_EQ(map, copied);
+  EXPECT_EQ(1, copied.at("foo"_pc));
+
+  auto moved = std::move(copied);
+  EXPECT_EQ(2, moved.at("bar"_pc));
+  moved["baz"_pc] = 3;
+  EXPECT_NE(map, moved);
+  EXPECT_EQ(3, moved.at("baz"_pc));
+  EXPECT_EQ(1, moved.at("foo"_pc));
+}
+
+TEST(HashIndexedPathMap, batchUpdatesRebuildIndex) {
+  HashIndexedPathMap<int> map(CaseSensitivity::Insensitive, 2);
+  map["b"_pc] = 1;
+  map["d"_pc] = 2;
+  ASSERT_TRUE(map.isIndexed());
+
+  folly::fbvector<std::pair<PathComponent, int>> batch{
+      {PathComponent{"a"}, 10},
+      {PathComponent{"B"}, 11},
+      {PathComponent{"c"}, 12},
+  };
+  EXPECT_EQ(2, map.mergeSorted(batch));
+  EXPECT_EQ(10, map.at("A"_pc));
+  EXPECT_EQ(1, map.at("B"_pc));
+  EXPECT_EQ(12, map.at("C"_pc));
+  EXPECT_EQ(2, map.at("D"_pc));
+
+  std::vector<PathComponentPiece> keys{"A"_pc, "c"_pc};
+  EXPECT_EQ(2, map.eraseSorted(keys));
+  EXPECT_EQ(map.end(), map.find("a"_pc));
+  EXPECT_EQ(1, map.at("b"_pc));
+  EXPECT_EQ(2, map.at("d"_pc));
+}
+
+namespace {
+
+// Drive a HashIndexedPathMap and a plain PathMap with the same random
+// operations and check they always agree.
+void checkAgainstPathMap(CaseSensitivity caseSensitive) {
+  std::mt19937 rng{1234};
+  auto randomName = [&] {
+    static constexpr std::string_view kChars = "aAbBcC";
+    std::string name;
+    auto len = 1 + rng() % 3;
+    for (size_t i = 0; i < len; ++i) {
+      name.push_back(kChars[rng() % kChars.size()]);
+    }
+    return PathComponent{name};
+  };
+
+  PathMap<int> expected{caseSensitive};
+  HashIndexedPathMap<int> map{caseSensitive, 8};
+  for (int i = 0; i < 5000; ++i) {
+    auto name = randomName();
+    switch (rng() % 4) {
+      case 0:
+        EXPECT_EQ(
+            expected.emplace(name, i).second, map.emplace(name, i).second);
+        break;
+      case 1:
+        expected[name] = i;
+        map[name] = i;
+        break;
+      case 2:
+        EXPECT_EQ(expected.erase(name), map.erase(name));
+        break;
+      case 3: {
+        auto it = expected.find(name);
+        auto actual = map.find(name);
+        if (it == expected.end()) {
+          EXPECT_EQ(map.end(), actual);
+        } else {
+          ASSERT_NE(map.end(), actual);
+          EXPECT_EQ(it->first, actual->first);
+          EXPECT_EQ(it->second, actual->second);
+        }
+        break;
+      }
+    }
+    ASSERT_EQ(expected.size(), map.size());
+  }
+
+  EXPECT_TRUE(map.isIndexed());
+  ASSERT_TRUE(std::equal(
+      expected.begin(), expected.end(), map.begin(), map.end()));
+}
+
+} // namespace
+
+TEST(HashIndexedPathMap, matchesPathMapSensitive) {
+  checkAgainstPathMap(CaseSensitivity::Sensitive);
+}
+
+TEST(HashIndexedPathMap, matchesPathMapInsensitive) {
+  checkAgainstPathMap(CaseSensitivity::Insensitive);
+}
+
+TEST(HashIndexedPathMap, relativePathKeys) {
+  HashIndexedPathMap<int, RelativePath> map(CaseSensitivity::Insensitive, 1);
+  map.emplace("foo/bar"_relpath, 1);
+  map.emplace("foo/baz"_relpath, 2);
+  EXPECT_EQ(1, map.at("FOO/Bar"_relpath));
+  EXPECT_EQ(1, map.count("foo/BAZ"_relpath));
+  EXPECT_EQ(0, map.count("foo"_relpath));
+}
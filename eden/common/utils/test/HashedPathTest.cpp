@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/HashedPath.h"
+
+#include <fmt/format.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
+#include <folly/portability/GTest.h>
+#include <unordered_set>
+
+using namespace facebook::eden;
+using namespace facebook::eden::path_literals;
+
+TEST(HashedPath, hashMatchesPiece) {
+  HashedRelativePath path{"foo/bar/baz"_relpath};
+  EXPECT_EQ(std::hash<RelativePathPiece>{}("foo/bar/baz"_relpath), path.hash());
+  EXPECT_EQ(path.hash(), std::hash<HashedRelativePath>{}(path));
+  EXPECT_EQ("foo/bar/baz"_relpath, path.piece());
+  EXPECT_EQ("foo/bar/baz", fmt::format("{}", path));
+
+  HashedRelativePath moved{RelativePath{"foo/bar/baz"}};
+  EXPECT_EQ(path, moved);
+  EXPECT_EQ(path.hash(), moved.hash());
+
+  auto absPath = HashedAbsolutePath{canonicalPath("/foo/bar")};
+  EXPECT_EQ(std::hash<AbsolutePathPiece>{}(absPath.piece()), absPath.hash());
+}
+
+TEST(HashedPath, copyAndMoveKeepHash) {
+  HashedRelativePath path{"a/b/c"_relpath};
+  auto copied = path.copy();
+  EXPECT_EQ(path, copied);
+  EXPECT_EQ(path.hash(), copied.hash());
+  EXPECT_NE(path.view().data(), copied.view().data());
+
+  auto moved = std::move(copied);
+  EXPECT_EQ(path, moved);
+  EXPECT_EQ(path.hash(), moved.hash());
+
+  HashedRelativePath other{"a/b/d"_relpath};
+  other = path;
+  EXPECT_EQ(path, other);
+  EXPECT_EQ(path.hash(), other.hash());
+}
+
+TEST(HashedPath, comparesWithPiece) {
+  HashedRelativePath path{"a/b"_relpath};
+  EXPECT_EQ(path, "a/b"_relpath);
+  EXPECT_EQ("a/b"_relpath, path);
+  EXPECT_NE(path, "a/c"_relpath);
+  EXPECT_NE(path, HashedRelativePath{"a/c"_relpath});
+}
+
+TEST(HashedPath, stdUnorderedSet) {
+  std::unordered_set<HashedRelativePath> set;
+  set.emplace("a/b"_relpath);
+  set.emplace("a/c"_relpath);
+  set.emplace("a/b"_relpath);
+  EXPECT_EQ(2, set.size());
+  EXPECT_EQ(1, set.count(HashedRelativePath{"a/c"_relpath}));
+}
+
+TEST(HashedPath, f14HeterogeneousLookup) {
+  folly::F14FastMap<HashedRelativePath, int> map;
+  map.emplace(HashedRelativePath{"foo/bar"_relpath}, 1);
+  map.emplace(HashedRelativePath{"foo/baz"_relpath}, 2);
+
+  // Lookup with the Piece type doesn't build a HashedRelativePath.
+  auto it = map.find("foo/bar"_relpath);
+  ASSERT_NE(map.end(), it);
+  EXPECT_EQ(1, it->second);
+  EXPECT_EQ(1, map.count("foo/baz"_relpath));
+  EXPECT_EQ(0, map.count("foo"_relpath));
+  EXPECT_EQ(2, map.at(HashedRelativePath{"foo/baz"_relpath}));
+
+  folly::F14NodeSet<HashedAbsolutePath> set;
+  set.emplace(canonicalPath("/a/b"));
+  EXPECT_TRUE(set.contains(canonicalPath("/a/b").piece()));
+  EXPECT_FALSE(set.contains(canonicalPath("/a/c").piece()));
+}
@@ -10,6 +10,7 @@
 #include <folly/CPortability.h>
 
 #include "eden/common/utils/ImmediateFuture.h"
+#include "eden/common/utils/ImmediateTask.h"
 
 namespace {
 
@@ -84,4 +85,102 @@ void folly_Future_thenValue_with_int(benchmark::State& state) {
 }
 BENCHMARK(folly_Future_thenValue_with_int);
 
+/**
+ * The value a chain starts from: ready, or behind a SemiFuture that is only
+ * run once the chain is consumed.
+ */
+ImmediateFuture<uint64_t> chainStart(bool ready) {
+  if (ready) {
+    return uint64_t{0};
+  }
+  return makeNotReadyImmediateFuture().thenValue(
+      [](folly::Unit) { return uint64_t{0}; });
+}
+
+/**
+ * Attach state.range(0) continuations to an ImmediateFuture, then consume it.
+ */
+void ImmediateFuture_thenValue_chain(benchmark::State& state, bool ready) {
+  auto depth = state.range(0);
+  for (auto _ : state) {
+    auto fut = chainStart(ready);
+    for (int64_t i = 0; i < depth; ++i) {
+      fut = std::move(fut).thenValue([](uint64_t v) { return v + 1; });
+    }
+    benchmark::DoNotOptimize(std::move(fut).get());
+  }
+  state.SetItemsProcessed(state.iterations() * depth);
+}
+BENCHMARK_CAPTURE(ImmediateFuture_thenValue_chain, ready, true)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000);
+BENCHMARK_CAPTURE(ImmediateFuture_thenValue_chain, not_ready, false)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000);
+
+#if FOLLY_HAS_COROUTINES
+
+ImmediateTask<uint64_t> nestedTasks(
+    ImmediateFuture<uint64_t> fut,
+    int64_t depth) {
+  if (depth == 0) {
+    co_return co_await std::move(fut);
+  }
+  co_return co_await nestedTasks(std::move(fut), depth - 1) + 1;
+}
+
+/**
+ * The coroutine equivalent of ImmediateFuture_thenValue_chain: state.range(0)
+ * nested ImmediateTasks, each adding one to the result of the next.
+ */
+void ImmediateTask_nested_chain(benchmark::State& state, bool ready) {
+  auto depth = state.range(0);
+  for (auto _ : state) {
+    auto task = nestedTasks(chainStart(ready), depth);
+    benchmark::DoNotOptimize(std::move(task).toImmediateFuture().get());
+  }
+  state.SetItemsProcessed(state.iterations() * depth);
+}
+BENCHMARK_CAPTURE(ImmediateTask_nested_chain, ready, true)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000);
+BENCHMARK_CAPTURE(ImmediateTask_nested_chain, not_ready, false)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000);
+
+/**
+ * A single coroutine awaiting state.range(0) ready ImmediateFutures in a
+ * loop.
+ */
+ImmediateTask<uint64_t> awaitLoop(ImmediateFuture<uint64_t> fut, int64_t n) {
+  auto value = co_await std::move(fut);
+  for (int64_t i = 0; i < n; ++i) {
+    value = co_await ImmediateFuture<uint64_t>{value + 1};
+  }
+  co_return value;
+}
+
+void ImmediateTask_await_loop(benchmark::State& state, bool ready) {
+  auto depth = state.range(0);
+  for (auto _ : state) {
+    auto task = awaitLoop(chainStart(ready), depth);
+    benchmark::DoNotOptimize(std::move(task).toImmediateFuture().get());
+  }
+  state.SetItemsProcessed(state.iterations() * depth);
+}
+BENCHMARK_CAPTURE(ImmediateTask_await_loop, ready, true)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000);
+BENCHMARK_CAPTURE(ImmediateTask_await_loop, not_ready, false)
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000);
+
+#endif
+
 } // namespace
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/ImmediateLeaseCache.h"
+
+#include <folly/executors/ManualExecutor.h>
+#include <folly/portability/GTest.h>
+#include <map>
+#include <stdexcept>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+
+using Cache = ImmediateLeaseCache<int, int>;
+
+/**
+ * Returns key * 100 plus the number of times key was fetched before, or
+ * fails while `failing` is set.
+ */
+struct CountingFetcher {
+  Cache::FutureType operator()(int key) {
+    ++fetches;
+    auto count = fetchesOf[key]++;
+    if (failing) {
+      return makeImmediateFuture<std::shared_ptr<int>>(
+          std::runtime_error("fetch failed"));
+    }
+    return std::make_shared<int>(key * 100 + count);
+  }
+
+  int fetches{0};
+  std::map<int, int> fetchesOf;
+  bool failing{false};
+};
+
+struct Fixture : ::testing::Test {
+  Cache makeCache(Cache::Options options = {}) {
+    options.now = [this] { return now; };
+    return Cache{std::move(options), [this](const int& key) {
+                   return fetcher(key);
+                 }};
+  }
+
+  Cache::Clock::time_point now{Cache::Clock::now()};
+  CountingFetcher fetcher;
+};
+
+} // namespace
+
+TEST_F(Fixture, hitsAreImmediate) {
+  auto cache = makeCache();
+  EXPECT_EQ(100, *cache.get(1).get());
+
+  auto hit = cache.get(1);
+  if (!detail::kImmediateFutureAlwaysDefer) {
+    EXPECT_TRUE(hit.debugIsImmediate());
+  }
+  EXPECT_EQ(100, *std::move(hit).get());
+  EXPECT_EQ(1, fetcher.fetches);
+}
+
+TEST_F(Fixture, pendingFetchIsShared) {
+  folly::Promise<std::shared_ptr<int>> promise;
+  int fetches = 0;
+  Cache cache{{}, [&](const int&) -> Cache::FutureType {
+                ++fetches;
+                return promise.getSemiFuture();
+              }};
+
+  auto first = cache.get(1);
+  auto second = cache.get(1);
+  EXPECT_FALSE(first.isReady());
+  EXPECT_EQ(1, fetches);
+
+  promise.setValue(std::make_shared<int>(42));
+  EXPECT_EQ(42, *std::move(first).get());
+  EXPECT_EQ(42, *std::move(second).get());
+  EXPECT_EQ(42, *cache.get(1).get());
+  EXPECT_EQ(1, fetches);
+}
+
+TEST_F(Fixture, valuesExpireAfterTtl) {
+  Cache::Options options;
+  options.ttl = 10s;
+  auto cache = makeCache(options);
+
+  EXPECT_EQ(100, *cache.get(1).get());
+  now += 9s;
+  EXPECT_EQ(100, *cache.get(1).get());
+  now += 1s;
+  EXPECT_EQ(101, *cache.get(1).get());
+  EXPECT_EQ(2, fetcher.fetches);
+}
+
+TEST_F(Fixture, ttlForOverridesTtl) {
+  Cache::Options options;
+  options.ttl = 10s;
+  options.ttlFor = [](const int& key, const int&) {
+    return std::chrono::nanoseconds{key == 1 ? 1s : 100s};
+  };
+  auto cache = makeCache(options);
+
+  cache.get(1);
+  cache.get(2);
+  now += 2s;
+  EXPECT_EQ(101, *cache.get(1).get());
+  EXPECT_EQ(200, *cache.get(2).get());
+
+  // An explicit ttl wins over ttlFor.
+  cache.set(2, std::make_shared<int>(7), 1s);
+  now += 2s;
+  EXPECT_EQ(201, *cache.get(2).get());
+}
+
+TEST_F(Fixture, failuresAreNotCachedByDefault) {
+  auto cache = makeCache();
+
+  fetcher.failing = true;
+  EXPECT_THROW(cache.get(1).get(), std::runtime_error);
+  EXPECT_FALSE(cache.exists(1));
+
+  fetcher.failing = false;
+  EXPECT_EQ(101, *cache.get(1).get());
+}
+
+TEST_F(Fixture, failuresAreCachedForNegativeTtl) {
+  Cache::Options options;
+  options.ttl = 1min;
+  options.negativeTtl = 1s;
+  auto cache = makeCache(options);
+
+  fetcher.failing = true;
+  EXPECT_THROW(cache.get(1).get(), std::runtime_error);
+  fetcher.failing = false;
+  EXPECT_THROW(cache.get(1).get(), std::runtime_error);
+  EXPECT_EQ(1, fetcher.fetches);
+
+  now += 1s;
+  EXPECT_EQ(101, *cache.get(1).get());
+}
+
+TEST_F(Fixture, refreshesAheadOfExpiry) {
+  folly::ManualExecutor executor;
+  Cache::Options options;
+  options.ttl = 10s;
+  options.refreshAhead = 2s;
+  options.executor = &executor;
+  auto cache = makeCache(options);
+
+  EXPECT_EQ(100, *cache.get(1).get());
+  now += 8s;
+  // The hit schedules a refresh, but returns the cached value right away.
+  EXPECT_EQ(100, *cache.get(1).get());
+  EXPECT_EQ(100, *cache.get(1).get());
+  EXPECT_EQ(1, fetcher.fetches);
+
+  executor.drain();
+  EXPECT_EQ(2, fetcher.fetches);
+  EXPECT_EQ(101, *cache.get(1).get());
+
+  // The refreshed value got a new ttl.
+  now += 7s;
+  EXPECT_EQ(101, *cache.get(1).get());
+  executor.drain();
+  EXPECT_EQ(2, fetcher.fetches);
+}
+
+TEST_F(Fixture, failedRefreshKeepsValue) {
+  folly::ManualExecutor executor;
+  Cache::Options options;
+  options.ttl = 10s;
+  options.refreshAhead = 2s;
+  options.executor = &executor;
+  auto cache = makeCache(options);
+
+  EXPECT_EQ(100, *cache.get(1).get());
+  now += 8s;
+  fetcher.failing = true;
+  EXPECT_EQ(100, *cache.get(1).get());
+  executor.drain();
+  EXPECT_EQ(2, fetcher.fetches);
+  EXPECT_EQ(100, *cache.get(1).get());
+
+  // Once it expires, the failure is not cached.
+  now += 2s;
+  EXPECT_THROW(cache.get(1).get(), std::runtime_error);
+  EXPECT_FALSE(cache.exists(1));
+}
+
+TEST_F(Fixture, evictsToFitMaxSize) {
+  Cache::Options options;
+  options.maxSize = 2;
+  options.numShards = 1;
+  auto cache = makeCache(options);
+
+  cache.get(1);
+  cache.get(2);
+  cache.get(3);
+  EXPECT_EQ(2, cache.size());
+  EXPECT_TRUE(cache.exists(3));
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/ImmediateTask.h"
+
+#include <folly/portability/GTest.h>
+
+#if FOLLY_HAS_COROUTINES
+
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+using namespace facebook::eden;
+
+ImmediateTask<int> addOne(ImmediateFuture<int> future) {
+  auto value = co_await std::move(future);
+  co_return value + 1;
+}
+
+ImmediateTask<int> addTwo(ImmediateFuture<int> future) {
+  auto value = co_await addOne(std::move(future));
+  co_return co_await addOne(ImmediateFuture<int>{value});
+}
+
+ImmediateTask<int> fail() {
+  throw std::logic_error("failed");
+  co_return 0;
+}
+
+TEST(ImmediateTask, readyPathCompletesSynchronously) {
+  auto task = addTwo(ImmediateFuture<int>{40});
+  EXPECT_TRUE(task.isReady());
+
+  auto future = std::move(task).toImmediateFuture();
+  EXPECT_TRUE(future.isReady());
+  EXPECT_EQ(42, std::move(future).get());
+}
+
+TEST(ImmediateTask, resumesWhenConsumed) {
+  auto [promise, semi] = folly::makePromiseContract<int>();
+  auto task = addTwo(std::move(semi));
+  EXPECT_FALSE(task.isReady());
+
+  auto future = std::move(task).toImmediateFuture();
+  EXPECT_FALSE(future.isReady());
+
+  promise.setValue(40);
+  EXPECT_EQ(42, std::move(future).get());
+}
+
+TEST(ImmediateTask, resumesOnConsumingThread) {
+  auto [promise, semi] = folly::makePromiseContract<folly::Unit>();
+  auto task = [](folly::SemiFuture<folly::Unit> semi)
+      -> ImmediateTask<std::thread::id> {
+    co_await std::move(semi);
+    co_return std::this_thread::get_id();
+  }(std::move(semi));
+
+  std::thread{[promise = std::move(promise)]() mutable {
+    promise.setValue();
+  }}.join();
+  EXPECT_EQ(
+      std::this_thread::get_id(), std::move(task).toImmediateFuture().get());
+}
+
+TEST(ImmediateTask, exceptionsAreCaptured) {
+  auto task = fail();
+  EXPECT_TRUE(task.isReady());
+  EXPECT_THROW(std::move(task).toImmediateFuture().get(), std::logic_error);
+
+  auto failed = addOne(makeImmediateFuture<int>(std::runtime_error("no")));
+  EXPECT_THROW(std::move(failed).toImmediateFuture().get(), std::runtime_error);
+}
+
+TEST(ImmediateTask, droppingSuspendedTaskDestroysFrame) {
+  auto [promise, semi] = folly::makePromiseContract<int>();
+  {
+    auto task = addOne(std::move(semi));
+    EXPECT_FALSE(task.isReady());
+  }
+  {
+    auto [promise2, semi2] = folly::makePromiseContract<int>();
+    auto future = addOne(std::move(semi2)).toImmediateFuture();
+  }
+  promise.setValue(1);
+}
+
+} // namespace
+
+#endif
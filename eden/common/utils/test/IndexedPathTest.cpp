@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/IndexedPath.h"
+
+#include <folly/portability/GTest.h>
+#include <vector>
+
+using namespace facebook::eden;
+using namespace facebook::eden::path_literals;
+
+namespace {
+
+template <typename Range>
+auto collect(const Range& range) {
+  using Value = std::remove_const_t<
+      typename std::iterator_traits<decltype(range.begin())>::value_type>;
+  return std::vector<Value>(range.begin(), range.end());
+}
+
+template <typename Piece>
+void checkSameAsPath(Piece path) {
+  SCOPED_TRACE(path.view());
+  IndexedPath<Piece> indexed{path};
+  EXPECT_EQ(path, indexed.path());
+  EXPECT_EQ(collect(path.paths()), collect(indexed.paths()));
+  EXPECT_EQ(collect(path.rpaths()), collect(indexed.rpaths()));
+  EXPECT_EQ(collect(path.components()), collect(indexed.components()));
+  EXPECT_EQ(collect(path.rcomponents()), collect(indexed.rcomponents()));
+  EXPECT_EQ(collect(path.suffixes()), collect(indexed.suffixes()));
+  EXPECT_EQ(collect(path.rsuffixes()), collect(indexed.rsuffixes()));
+  EXPECT_EQ(path.dirname(), indexed.dirname());
+  EXPECT_EQ(path.basename(), indexed.basename());
+  EXPECT_EQ(collect(path.components()).size(), indexed.depth());
+}
+
+} // namespace
+
+TEST(IndexedPath, relativeMatchesPath) {
+  for (auto path :
+       {""_relpath,
+        "foo"_relpath,
+        "foo/bar"_relpath,
+        "foo/bar/baz"_relpath,
+        "a/b/c/d/e/f/g/h/i/j/k/l/m/n/o/p/q/r/s/t"_relpath}) {
+    checkSameAsPath(path);
+    IndexedRelativePath indexed{path};
+    EXPECT_EQ(collect(path.allPaths()), collect(indexed.allPaths()));
+    EXPECT_EQ(collect(path.rallPaths()), collect(indexed.rallPaths()));
+  }
+}
+
+TEST(IndexedPath, absoluteMatchesPath) {
+  for (auto path :
+       {canonicalPath("/"),
+        canonicalPath("/foo"),
+        canonicalPath("/foo/bar/baz")}) {
+    checkSameAsPath(path.piece());
+  }
+}
+
+TEST(IndexedPath, accessors) {
+  IndexedRelativePath path{"foo/bar/baz"_relpath};
+  EXPECT_EQ(3, path.depth());
+  EXPECT_EQ("bar"_pc, path.component(1));
+  EXPECT_EQ(""_relpath, path.prefix(0));
+  EXPECT_EQ("foo/bar"_relpath, path.prefix(2));
+  EXPECT_EQ("bar/baz"_relpath, path.suffix(1));
+  EXPECT_EQ(""_relpath, path.suffix(3));
+
+  auto absPath = canonicalPath("/foo/bar");
+  IndexedAbsolutePath abs{absPath.piece()};
+  EXPECT_EQ(2, abs.depth());
+  EXPECT_EQ(canonicalPath("/"), abs.prefix(0));
+  EXPECT_EQ(canonicalPath("/foo"), abs.prefix(1));
+}
+
+TEST(IndexedPath, iteratorsGoBothWays) {
+  IndexedRelativePath path{"a/b/c"_relpath};
+  auto it = path.paths().end();
+  --it;
+  EXPECT_EQ("a/b/c"_relpath, *it);
+  --it;
+  EXPECT_EQ("a/b"_relpath, *it);
+  ++it;
+  EXPECT_EQ("a/b/c"_relpath, *it);
+
+  auto rit = path.rallPaths().begin();
+  ++rit;
+  ++rit;
+  ++rit;
+  EXPECT_EQ(""_relpath, *rit);
+  ++rit;
+  EXPECT_EQ(path.rallPaths().end(), rit);
+}
+
+TEST(IndexedPath, findParent) {
+  auto raw = "foo/bar/baz"_relpath;
+  IndexedRelativePath path{raw};
+  for (auto parent :
+       {""_relpath,
+        "foo"_relpath,
+        "foo/bar"_relpath,
+        "foo/bar/baz"_relpath,
+        "fo"_relpath,
+        "foo/ba"_relpath,
+        "foo/bar/baz/qux"_relpath,
+        "bar"_relpath}) {
+    SCOPED_TRACE(parent.view());
+    EXPECT_EQ(raw.isSubDirOf(parent), path.isSubDirOf(parent));
+    EXPECT_EQ(
+        raw.isSubDirOf(parent),
+        path.isSubDirOf(IndexedRelativePath{parent}));
+
+    auto expected = raw.findParent(parent);
+    auto actual = path.findParent(parent);
+    if (expected == raw.allPaths().end()) {
+      EXPECT_EQ(path.allPaths().end(), actual);
+    } else {
+      ASSERT_NE(path.allPaths().end(), actual);
+      EXPECT_EQ(*expected, *actual);
+      // Walk the remaining ancestors from the parent.
+      EXPECT_EQ(
+          std::vector<RelativePathPiece>(++expected, raw.allPaths().end()),
+          std::vector<RelativePathPiece>(++actual, path.allPaths().end()));
+    }
+  }
+
+  auto absPath = canonicalPath("/foo/bar");
+  IndexedAbsolutePath abs{absPath.piece()};
+  EXPECT_TRUE(abs.isSubDirOf(canonicalPath("/").piece()));
+  EXPECT_TRUE(abs.isSubDirOf(canonicalPath("/foo").piece()));
+  EXPECT_FALSE(abs.isSubDirOf(canonicalPath("/foo/bar").piece()));
+  EXPECT_FALSE(abs.isSubDirOf(canonicalPath("/fo").piece()));
+}
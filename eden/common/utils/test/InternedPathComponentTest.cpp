@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/InternedPathComponent.h"
+
+#include <fmt/format.h>
+#include <folly/portability/GTest.h>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "eden/common/utils/PathMap.h"
+
+using namespace facebook::eden;
+using namespace facebook::eden::path_literals;
+
+TEST(InternedPathComponent, sameNameSameHandle) {
+  PathComponentInterner interner;
+  auto a = interner.intern("foo"_pc);
+  auto b = interner.intern(PathComponent{"foo"});
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a.view().data(), b.view().data());
+  EXPECT_EQ("foo"_pc, a.piece());
+  EXPECT_EQ(1, interner.size());
+
+  auto c = interner.intern("Foo"_pc);
+  EXPECT_NE(a, c);
+  EXPECT_EQ(2, interner.size());
+}
+
+TEST(InternedPathComponent, hashMatchesPathComponentPiece) {
+  PathComponentInterner interner;
+  for (auto name :
+       {"a"_pc, "BUCK"_pc, "__init__.py"_pc, "\xc3\xa9t\xc3\xa9"_pc}) {
+    auto interned = interner.intern(name);
+    EXPECT_EQ(std::hash<PathComponentPiece>{}(name), interned.hash());
+    EXPECT_EQ(
+        std::hash<PathComponentPiece>{}(name),
+        std::hash<InternedPathComponent>{}(interned));
+  }
+}
+
+TEST(InternedPathComponent, distinctInterners) {
+  PathComponentInterner first;
+  PathComponentInterner second;
+  auto a = first.intern("foo"_pc);
+  auto b = second.intern("foo"_pc);
+  EXPECT_NE(a, b);
+  EXPECT_EQ(a.piece(), b.piece());
+}
+
+TEST(InternedPathComponent, defaultInterner) {
+  InternedPathComponent a{"default"_pc};
+  auto b = PathComponentInterner::getDefault().intern("default"_pc);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ("default", fmt::format("{}", a));
+}
+
+TEST(InternedPathComponent, concurrentIntern) {
+  constexpr size_t kThreads = 8;
+  constexpr size_t kNames = 2000;
+
+  PathComponentInterner interner;
+  std::vector<std::vector<InternedPathComponent>> results(kThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      results[t].reserve(kNames);
+      for (size_t i = 0; i < kNames; ++i) {
+        // Walk the names in a different order on each thread so they race to
+        // insert the same entries.
+        auto n = (i * (2 * t + 1)) % kNames;
+        results[t].push_back(
+            interner.intern(PathComponent{fmt::format("name{}", n)}));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(kNames, interner.size());
+  for (size_t t = 0; t < kThreads; ++t) {
+    for (size_t i = 0; i < kNames; ++i) {
+      auto n = (i * (2 * t + 1)) % kNames;
+      auto& interned = results[t][i];
+      EXPECT_EQ(fmt::format("name{}", n), interned.view());
+      // Every thread got the same handle for the same name.
+      EXPECT_EQ(results[0][n], interned);
+    }
+  }
+}
+
+TEST(InternedPathComponent, pathMapKey) {
+  PathMap<int, InternedPathComponent> map{CaseSensitivity::Insensitive};
+  map.emplace("foo"_pc, 1);
+  map["bar"_pc] = 2;
+  EXPECT_FALSE(map.emplace("FOO"_pc, 3).second);
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ(1, map.at("Foo"_pc));
+  EXPECT_EQ(InternedPathComponent{"bar"_pc}, map.begin()->first);
+
+  auto copy = map;
+  EXPECT_EQ(map, copy);
+  copy["baz"_pc] = 3;
+  EXPECT_NE(map, copy);
+  EXPECT_EQ(1, map.erase("FOO"_pc));
+  EXPECT_EQ(map.end(), map.find("foo"_pc));
+}
+
+TEST(InternedPathComponent, pathMapFromUnsortedVector) {
+  using Map = PathMap<int, InternedPathComponent>;
+  folly::fbvector<std::pair<InternedPathComponent, int>> entries;
+  entries.emplace_back(InternedPathComponent{"b"_pc}, 1);
+  entries.emplace_back(InternedPathComponent{"a"_pc}, 2);
+  entries.emplace_back(InternedPathComponent{"B"_pc}, 3);
+  Map map{std::move(entries), CaseSensitivity::Insensitive};
+
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ(2, map.at("A"_pc));
+  // The earliest entry wins.
+  EXPECT_EQ(1, map.at("b"_pc));
+  EXPECT_EQ(InternedPathComponent{"b"_pc}, map.find("B"_pc)->first);
+}
+
+TEST(InternedPathComponent, collatePathMaps) {
+  using Map = PathMap<int, InternedPathComponent>;
+  Map a{CaseSensitivity::Sensitive};
+  a["one"_pc] = 1;
+  a["two"_pc] = 2;
+  Map b{CaseSensitivity::Sensitive};
+  b["two"_pc] = 20;
+  b["three"_pc] = 30;
+
+  using Collated = std::pair<std::optional<int>, std::optional<int>>;
+  auto result = collatePathMaps(a, b);
+  ASSERT_EQ(3, result.size());
+  EXPECT_EQ(Collated(1, std::nullopt), result.at("one"_pc));
+  EXPECT_EQ(Collated(std::nullopt, 30), result.at("three"_pc));
+  EXPECT_EQ(Collated(2, 20), result.at("two"_pc));
+}
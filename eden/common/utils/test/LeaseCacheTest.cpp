@@ -0,0 +1,484 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/LeaseCache.h"
+
+#include <folly/executors/ManualExecutor.h>
+#include <folly/portability/GTest.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace facebook::eden;
+
+namespace {
+
+/**
+ * A fetcher whose fetches complete when the test fulfills them.
+ */
+struct ManualFetcher {
+  folly::Future<std::shared_ptr<int>> operator()(int key) {
+    ++fetches[key];
+    auto [promise, future] =
+        folly::makePromiseContract<std::shared_ptr<int>>();
+    pending.emplace(key, std::move(promise));
+    return std::move(future);
+  }
+
+  void fulfill(int key, int value) {
+    auto it = pending.find(key);
+    ASSERT_NE(pending.end(), it);
+    it->second.setValue(std::make_shared<int>(value));
+    pending.erase(it);
+  }
+
+  std::map<int, int> fetches;
+  std::multimap<int, folly::Promise<std::shared_ptr<int>>> pending;
+};
+
+LeaseCache<int, int>::FetchFunc immediateFetcher(std::atomic<int>& fetches) {
+  return [&fetches](int key) {
+    ++fetches;
+    return folly::makeFuture(std::make_shared<int>(key * 10));
+  };
+}
+
+} // namespace
+
+TEST(LeaseCache, concurrentGetsShareOneFetch) {
+  ManualFetcher fetcher;
+  LeaseCache<int, int> cache{
+      100, [&](const int& key) { return fetcher(key); }};
+
+  auto first = cache.get(1);
+  auto second = cache.get(1);
+  EXPECT_FALSE(first.isReady());
+  EXPECT_FALSE(second.isReady());
+  EXPECT_EQ(1, fetcher.fetches[1]);
+
+  fetcher.fulfill(1, 42);
+  EXPECT_EQ(42, *std::move(first).get());
+  EXPECT_EQ(42, *std::move(second).get());
+  EXPECT_EQ(42, *cache.get(1).get());
+  EXPECT_EQ(1, fetcher.fetches[1]);
+}
+
+TEST(LeaseCache, failedFetchIsShared) {
+  LeaseCache<int, int> cache{10, [](const int&) {
+                               return folly::makeFuture<std::shared_ptr<int>>(
+                                   std::runtime_error("fetch failed"));
+                             }};
+  EXPECT_THROW(cache.get(1).get(), std::runtime_error);
+  EXPECT_TRUE(cache.exists(1));
+}
+
+TEST(LeaseCache, setEraseAndExists) {
+  std::atomic<int> fetches{0};
+  LeaseCache<int, int> cache{10, immediateFetcher(fetches)};
+
+  cache.set(1, std::make_shared<int>(7));
+  EXPECT_TRUE(cache.exists(1));
+  EXPECT_EQ(7, *cache.get(1).get());
+  EXPECT_EQ(0, fetches);
+
+  cache.erase(1);
+  EXPECT_FALSE(cache.exists(1));
+  EXPECT_EQ(10, *cache.get(1).get());
+  EXPECT_EQ(1, fetches);
+
+  // Erasing a missing key is fine.
+  cache.erase(2);
+  EXPECT_EQ(1, cache.size());
+}
+
+TEST(LeaseCache, evictsUnreferencedEntriesFirst) {
+  std::atomic<int> fetches{0};
+  LeaseCache<int, int> cache{
+      3, immediateFetcher(fetches), /*clearSize=*/1, /*numShards=*/1};
+
+  cache.get(1);
+  cache.get(2);
+  cache.get(3);
+  // Inserting 4 sweeps the clock once, clearing every reference bit, and
+  // evicts 1.
+  cache.get(4);
+  EXPECT_EQ(3, cache.size());
+  EXPECT_FALSE(cache.exists(1));
+
+  // A hit on 2 gives it a second chance: 3 goes next.
+  cache.get(2);
+  cache.get(5);
+  EXPECT_EQ(3, cache.size());
+  EXPECT_TRUE(cache.exists(2));
+  EXPECT_FALSE(cache.exists(3));
+}
+
+TEST(LeaseCache, maxSizeIsSplitAcrossShards) {
+  std::atomic<int> fetches{0};
+  LeaseCache<int, int> cache{
+      64, immediateFetcher(fetches), /*clearSize=*/1, /*numShards=*/4};
+  for (int i = 0; i < 1000; ++i) {
+    cache.get(i);
+  }
+  EXPECT_LE(cache.size(), 64);
+
+  cache.setMaxSize(8);
+  EXPECT_LE(cache.size(), 8);
+}
+
+TEST(LeaseCache, maxSizeBelowShardCount) {
+  std::atomic<int> fetches{0};
+  LeaseCache<int, int> cache{
+      3, immediateFetcher(fetches), /*clearSize=*/1, /*numShards=*/16};
+  for (int i = 0; i < 1000; ++i) {
+    cache.get(i);
+    ASSERT_LE(cache.size(), 3);
+  }
+  EXPECT_GT(cache.size(), 0);
+
+  // Every shard still holds one entry.
+  cache.setMaxSize(1);
+  for (int i = 0; i < 1000; ++i) {
+    cache.get(i);
+    ASSERT_LE(cache.size(), 2);
+  }
+}
+
+TEST(LeaseCache, zeroMaxSizeMeansNoLimit) {
+  std::atomic<int> fetches{0};
+  LeaseCache<int, int> cache{0, immediateFetcher(fetches)};
+  for (int i = 0; i < 1000; ++i) {
+    cache.get(i);
+  }
+  EXPECT_EQ(1000, cache.size());
+
+  cache.setMaxSize(10);
+  EXPECT_LE(cache.size(), 10);
+  cache.setMaxSize(0);
+  for (int i = 0; i < 1000; ++i) {
+    cache.get(i);
+  }
+  EXPECT_EQ(1000, cache.size());
+}
+
+TEST(LeaseCache, shrunkShardsStillShareFetches) {
+  ManualFetcher fetcher;
+  LeaseCache<int, int> cache{
+      100,
+      [&](const int& key) { return fetcher(key); },
+      /*clearSize=*/1,
+      /*numShards=*/16};
+  // Below the number of shards, most shards' share would round down to 0.
+  cache.setMaxSize(1);
+
+  std::vector<folly::Future<std::shared_ptr<int>>> futures;
+  for (int key = 0; key < 32; ++key) {
+    futures.push_back(cache.get(key));
+    futures.push_back(cache.get(key));
+    EXPECT_EQ(1, fetcher.fetches[key]);
+  }
+  for (int key = 0; key < 32; ++key) {
+    fetcher.fulfill(key, key);
+    EXPECT_EQ(key, *std::move(futures[2 * key]).get());
+    EXPECT_EQ(key, *std::move(futures[2 * key + 1]).get());
+  }
+}
+
+TEST(LeaseCache, concurrentGetsFromManyThreads) {
+  std::atomic<int> fetches{0};
+  LeaseCache<int, int> cache{1000, immediateFetcher(fetches)};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 10000; ++i) {
+        auto key = i % 500;
+        ASSERT_EQ(key * 10, *cache.get(key).get());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Every key fits, so each one was fetched exactly once.
+  EXPECT_EQ(500, fetches);
+}
+
+namespace {
+
+struct CountingObserver : LeaseCacheObserver {
+  void hit() override {
+    ++hits;
+  }
+  void miss() override {
+    ++misses;
+  }
+  void evicted(size_t weight) override {
+    ++evictions;
+    evictedWeight += weight;
+  }
+  void weightChanged(int64_t delta) override {
+    weight += delta;
+  }
+
+  std::atomic<int> hits{0};
+  std::atomic<int> misses{0};
+  std::atomic<int> evictions{0};
+  std::atomic<size_t> evictedWeight{0};
+  std::atomic<int64_t> weight{0};
+};
+
+} // namespace
+
+TEST(LeaseCache, evictsToFitMaxWeight) {
+  std::atomic<int> fetches{0};
+  auto observer = std::make_shared<CountingObserver>();
+  LeaseCache<int, int>::Options options;
+  options.numShards = 1;
+  options.weigher = [](const int&, const int& value) {
+    return static_cast<size_t>(value);
+  };
+  options.maxWeight = 100;
+  options.observer = observer;
+  LeaseCache<int, int> cache{options, immediateFetcher(fetches)};
+
+  // Values weigh key * 10.
+  cache.get(1);
+  cache.get(2);
+  cache.get(3);
+  EXPECT_EQ(60, cache.weight());
+  EXPECT_EQ(60, observer->weight);
+
+  cache.get(5);
+  EXPECT_LE(cache.weight(), 100);
+  EXPECT_TRUE(cache.exists(5));
+  EXPECT_EQ(cache.weight(), observer->weight);
+  EXPECT_EQ(110 - cache.weight(), observer->evictedWeight);
+
+  // A value heavier than the whole budget is returned but not kept.
+  EXPECT_EQ(200, *cache.get(20).get());
+  EXPECT_FALSE(cache.exists(20));
+  EXPECT_LE(cache.weight(), 100);
+
+  cache.set(4, std::make_shared<int>(30));
+  EXPECT_TRUE(cache.exists(4));
+  cache.setMaxWeight(30);
+  EXPECT_LE(cache.weight(), 30);
+
+  cache.erase(4);
+  EXPECT_EQ(cache.weight(), observer->weight);
+}
+
+TEST(LeaseCache, weighsValuesOnceFetched) {
+  ManualFetcher fetcher;
+  LeaseCache<int, int>::Options options;
+  options.weigher = [](const int&, const int& value) {
+    return static_cast<size_t>(value);
+  };
+  LeaseCache<int, int> cache{
+      options, [&](const int& key) { return fetcher(key); }};
+
+  auto future = cache.get(1);
+  EXPECT_EQ(0, cache.weight());
+  fetcher.fulfill(1, 42);
+  EXPECT_EQ(42, *std::move(future).get());
+  EXPECT_EQ(42, cache.weight());
+
+  // A fetch that completes after its entry was replaced does not count.
+  auto stale = cache.get(2);
+  cache.set(2, std::make_shared<int>(5));
+  fetcher.fulfill(2, 1000);
+  EXPECT_EQ(47, cache.weight());
+}
+
+TEST(LeaseCache, reportsHitsAndMisses) {
+  std::atomic<int> fetches{0};
+  auto observer = std::make_shared<CountingObserver>();
+  LeaseCache<int, int>::Options options;
+  options.maxSize = 2;
+  options.numShards = 1;
+  options.observer = observer;
+  LeaseCache<int, int> cache{options, immediateFetcher(fetches)};
+
+  cache.get(1);
+  cache.get(1);
+  cache.get(2);
+  cache.get(3);
+  EXPECT_EQ(1, observer->hits);
+  EXPECT_EQ(3, observer->misses);
+  EXPECT_EQ(1, observer->evictions);
+  EXPECT_EQ(0, observer->weight);
+}
+
+namespace {
+
+/**
+ * A batch fetcher that records the keys of each call and returns key * 10.
+ */
+struct BatchFetcher {
+  folly::Future<std::vector<folly::Try<std::shared_ptr<int>>>> operator()(
+      std::vector<int> keys) {
+    std::vector<folly::Try<std::shared_ptr<int>>> values;
+    for (auto key : keys) {
+      values.emplace_back(std::make_shared<int>(key * 10));
+    }
+    calls.push_back(std::move(keys));
+    return folly::makeFuture(std::move(values));
+  }
+
+  std::vector<std::vector<int>> calls;
+};
+
+LeaseCache<int, int> makeBatchingCache(
+    BatchFetcher& fetcher,
+    size_t maxBatchSize,
+    std::chrono::microseconds batchWindow) {
+  LeaseCache<int, int>::Options options;
+  options.batchFetcher = [&fetcher](std::vector<int> keys) {
+    return fetcher(std::move(keys));
+  };
+  options.maxBatchSize = maxBatchSize;
+  options.batchWindow = batchWindow;
+  return LeaseCache<int, int>{options, nullptr};
+}
+
+} // namespace
+
+TEST(LeaseCache, getBatchFetchesMissesTogether) {
+  BatchFetcher fetcher;
+  auto cache = makeBatchingCache(fetcher, 100, std::chrono::microseconds{0});
+  cache.set(1, std::make_shared<int>(7));
+
+  auto futures = cache.getBatch({1, 2, 3, 2});
+  ASSERT_EQ(4, futures.size());
+  EXPECT_EQ(7, *std::move(futures[0]).get());
+  EXPECT_EQ(20, *std::move(futures[1]).get());
+  EXPECT_EQ(30, *std::move(futures[2]).get());
+  EXPECT_EQ(20, *std::move(futures[3]).get());
+  EXPECT_EQ((std::vector<std::vector<int>>{{2, 3}}), fetcher.calls);
+
+  EXPECT_EQ(30, *cache.get(3).get());
+  EXPECT_EQ(1, fetcher.calls.size());
+}
+
+TEST(LeaseCache, getBatchSplitsAtMaxBatchSize) {
+  BatchFetcher fetcher;
+  auto cache = makeBatchingCache(fetcher, 2, std::chrono::microseconds{0});
+
+  auto futures = cache.getBatch({1, 2, 3, 4, 5});
+  EXPECT_EQ(50, *std::move(futures[4]).get());
+  EXPECT_EQ(
+      (std::vector<std::vector<int>>{{1, 2}, {3, 4}, {5}}), fetcher.calls);
+}
+
+TEST(LeaseCache, getsWithinBatchWindowAreCoalesced) {
+  BatchFetcher fetcher;
+  auto cache = makeBatchingCache(fetcher, 3, std::chrono::minutes{1});
+
+  auto first = cache.get(1);
+  auto second = cache.get(2);
+  auto again = cache.get(1);
+  EXPECT_TRUE(fetcher.calls.empty());
+
+  // The third distinct key fills the batch.
+  auto third = cache.get(3);
+  EXPECT_EQ(10, *std::move(first).get());
+  EXPECT_EQ(10, *std::move(again).get());
+  EXPECT_EQ(30, *std::move(third).get());
+  EXPECT_EQ((std::vector<std::vector<int>>{{1, 2, 3}}), fetcher.calls);
+}
+
+TEST(LeaseCache, getBatchFlushesPendingGets) {
+  BatchFetcher fetcher;
+  auto cache = makeBatchingCache(fetcher, 100, std::chrono::minutes{1});
+
+  auto pending = cache.get(1);
+  auto futures = cache.getBatch({1, 2});
+  EXPECT_EQ(10, *std::move(pending).get());
+  EXPECT_EQ(20, *std::move(futures[1]).get());
+  EXPECT_EQ((std::vector<std::vector<int>>{{1, 2}}), fetcher.calls);
+}
+
+TEST(LeaseCache, batchWindowElapses) {
+  BatchFetcher fetcher;
+  auto cache = makeBatchingCache(fetcher, 100, std::chrono::milliseconds{1});
+
+  auto future = cache.get(1);
+  EXPECT_EQ(10, *std::move(future).get());
+  EXPECT_EQ(1, fetcher.calls.size());
+}
+
+namespace {
+/**
+ * A Timekeeper that fails every sleep, like one that is shutting down.
+ */
+struct FailingTimekeeper : folly::Timekeeper {
+  folly::SemiFuture<folly::Unit> after(folly::HighResDuration) override {
+    return folly::makeSemiFuture<folly::Unit>(
+        std::runtime_error("timekeeper is gone"));
+  }
+};
+} // namespace
+
+TEST(LeaseCache, batchIsFetchedWhenTimerFails) {
+  BatchFetcher fetcher;
+  FailingTimekeeper timekeeper;
+  folly::ManualExecutor executor;
+  LeaseCache<int, int>::Options options;
+  options.batchFetcher = [&fetcher](std::vector<int> keys) {
+    return fetcher(std::move(keys));
+  };
+  options.batchWindow = std::chrono::minutes{1};
+  options.executor = &executor;
+  options.timekeeper = &timekeeper;
+  LeaseCache<int, int> cache{options, nullptr};
+
+  auto first = cache.get(1);
+  auto second = cache.get(2);
+  executor.drain();
+  EXPECT_EQ(10, *std::move(first).get());
+  EXPECT_EQ(20, *std::move(second).get());
+  EXPECT_EQ((std::vector<std::vector<int>>{{1, 2}}), fetcher.calls);
+
+  // The timer is armed again for later misses.
+  auto third = cache.get(3);
+  executor.drain();
+  EXPECT_EQ(30, *std::move(third).get());
+  EXPECT_EQ(2, fetcher.calls.size());
+}
+
+TEST(LeaseCache, batchFetcherMustReturnOneValuePerKey) {
+  LeaseCache<int, int>::Options options;
+  options.batchFetcher = [](std::vector<int>) {
+    return folly::makeFuture(std::vector<folly::Try<std::shared_ptr<int>>>{});
+  };
+  LeaseCache<int, int> cache{options, nullptr};
+
+  auto futures = cache.getBatch({1, 2});
+  EXPECT_THROW(std::move(futures[0]).get(), std::length_error);
+  EXPECT_THROW(std::move(futures[1]).get(), std::length_error);
+}
+
+TEST(LeaseCache, getBatchWithThrowingFetcher) {
+  LeaseCache<int, int> cache{
+      100, [](int key) -> folly::Future<std::shared_ptr<int>> {
+        if (key == 2) {
+          throw std::runtime_error("fetch failed");
+        }
+        return std::make_shared<int>(key * 10);
+      }};
+
+  auto futures = cache.getBatch({1, 2, 3});
+  ASSERT_EQ(3, futures.size());
+  EXPECT_EQ(10, *std::move(futures[0]).get());
+  EXPECT_THROW(std::move(futures[1]).get(), std::runtime_error);
+  EXPECT_EQ(30, *std::move(futures[2]).get());
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef _WIN32
+
+#include "eden/common/utils/MappedDiskVector.h"
+
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <folly/File.h>
+#include <folly/testing/TestUtil.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace facebook::eden;
+
+struct Record {
+  enum { VERSION = 0 };
+
+  /* implicit */ Record(uint64_t v) : value{v} {}
+  uint64_t value;
+  uint64_t padding[7];
+};
+
+// 64 MiB of records.
+constexpr size_t kRecords = 1 << 20;
+constexpr size_t kLookups = 4096;
+
+/**
+ * A file of kRecords records, written once and shared by every benchmark.
+ */
+struct Fixture {
+  Fixture()
+      : tmpDir{"eden_mdv_bench_"},
+        path{(tmpDir.path() / "bench.mdv").string()} {
+    auto mdv = MappedDiskVector<Record>::createOrOverwrite(path);
+    mdv.reserve(kRecords);
+    for (size_t i = 0; i < kRecords; ++i) {
+      mdv.emplace_back(i);
+    }
+
+    std::mt19937_64 rng{0};
+    for (size_t i = 0; i < kLookups; ++i) {
+      lookups.push_back(rng() % kRecords);
+    }
+  }
+
+  /**
+   * Write the file back and drop it from the page cache, so the next open
+   * has to read it from disk.
+   */
+  void evict() const {
+    folly::File file{path, O_RDONLY};
+    fdatasync(file.fd());
+    posix_fadvise(file.fd(), 0, 0, POSIX_FADV_DONTNEED);
+  }
+
+  folly::test::TemporaryDirectory tmpDir;
+  std::string path;
+  std::vector<size_t> lookups;
+};
+
+const Fixture& getFixture() {
+  static const Fixture fixture;
+  return fixture;
+}
+
+MappedDiskOptions defaults() {
+  return MappedDiskOptions{};
+}
+
+MappedDiskOptions populate() {
+  MappedDiskOptions options;
+  options.populate = true;
+  return options;
+}
+
+MappedDiskOptions willNeed() {
+  MappedDiskOptions options;
+  options.willNeed = true;
+  return options;
+}
+
+MappedDiskOptions hugePages() {
+  MappedDiskOptions options;
+  options.hugePages = true;
+  return options;
+}
+
+MappedDiskOptions sequentialAccess() {
+  MappedDiskOptions options;
+  options.accessPattern = MappedDiskAccessPattern::Sequential;
+  return options;
+}
+
+MappedDiskOptions randomAccess() {
+  MappedDiskOptions options;
+  options.accessPattern = MappedDiskAccessPattern::Random;
+  return options;
+}
+
+MappedDiskOptions lockedPrefix() {
+  MappedDiskOptions options;
+  options.lockHeader = true;
+  options.lockedPrefixInBytes = 1 << 20;
+  return options;
+}
+
+/**
+ * Open the file with nothing cached and read kLookups random records.
+ */
+void MappedDiskVector_cold_open(
+    benchmark::State& state,
+    MappedDiskOptions (*makeOptions)()) {
+  const auto& fixture = getFixture();
+  auto options = makeOptions();
+  for (auto _ : state) {
+    state.PauseTiming();
+    fixture.evict();
+    state.ResumeTiming();
+
+    auto mdv = MappedDiskVector<Record>::open(fixture.path, options);
+    uint64_t sum = 0;
+    for (auto index : fixture.lookups) {
+      sum += mdv[index].value;
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+}
+
+/**
+ * Read random records from a file that has been opened, and whose pages
+ * are cached, ahead of time.
+ */
+void MappedDiskVector_random_access(
+    benchmark::State& state,
+    MappedDiskOptions (*makeOptions)()) {
+  const auto& fixture = getFixture();
+  const auto mdv = MappedDiskVector<Record>::open(fixture.path, makeOptions());
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mdv[fixture.lookups[i++ % kLookups]].value);
+  }
+}
+
+BENCHMARK_CAPTURE(MappedDiskVector_cold_open, defaults, defaults)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(MappedDiskVector_cold_open, populate, populate)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(MappedDiskVector_cold_open, will_need, willNeed)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(MappedDiskVector_cold_open, huge_pages, hugePages)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(MappedDiskVector_cold_open, sequential, sequentialAccess)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(MappedDiskVector_cold_open, random, randomAccess)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(MappedDiskVector_cold_open, locked_prefix, lockedPrefix)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(MappedDiskVector_random_access, defaults, defaults);
+BENCHMARK_CAPTURE(MappedDiskVector_random_access, populate, populate);
+BENCHMARK_CAPTURE(MappedDiskVector_random_access, huge_pages, hugePages);
+BENCHMARK_CAPTURE(MappedDiskVector_random_access, random, randomAccess);
+BENCHMARK_CAPTURE(MappedDiskVector_random_access, locked_prefix, lockedPrefix);
+
+struct OldRecord {
+  enum { VERSION = 1 };
+
+  uint64_t value;
+};
+
+struct NewRecord {
+  enum { VERSION = 2 };
+
+  explicit NewRecord(const OldRecord& old) : value{old.value}, flags{0} {}
+  uint64_t value;
+  uint64_t flags;
+};
+
+/**
+ * Migrate a file of state.range(0) records with state.range(1) threads, 0
+ * meaning one per hardware thread.
+ */
+void MappedDiskVector_migrate(benchmark::State& state) {
+  folly::test::TemporaryDirectory tmpDir{"eden_mdv_bench_"};
+  auto path = (tmpDir.path() / "migrate.mdv").string();
+  auto count = static_cast<size_t>(state.range(0));
+
+  MappedDiskMigrationOptions migrationOptions;
+  migrationOptions.threads = static_cast<size_t>(state.range(1));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    {
+      auto mdv = MappedDiskVector<OldRecord>::createOrOverwrite(path);
+      mdv.reserve(count);
+      for (size_t i = 0; i < count; ++i) {
+        mdv.emplace_back(OldRecord{i});
+      }
+    }
+    state.ResumeTiming();
+
+    auto mdv = MappedDiskVector<NewRecord>::open<OldRecord>(
+        path, MappedDiskOptions{}, migrationOptions);
+    benchmark::DoNotOptimize(mdv.size());
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(MappedDiskVector_migrate)
+    ->Args({100'000'000, 1})
+    ->Args({100'000'000, 0})
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+#endif
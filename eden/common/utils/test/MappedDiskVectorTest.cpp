@@ -8,11 +8,28 @@
 #ifndef _WIN32
 
 #include "eden/common/utils/MappedDiskVector.h"
+#include "eden/common/utils/ConcurrentMappedDiskVector.h"
 
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <fmt/format.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
 #include <folly/testing/TestUtil.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <vector>
 
+using facebook::eden::ConcurrentMappedDiskVector;
+using facebook::eden::MappedDiskStorage;
 using facebook::eden::MappedDiskVector;
 using folly::test::TemporaryDirectory;
 
@@ -92,6 +109,334 @@ TEST_F(MappedDiskVectorTest, pop_back) {
   EXPECT_EQ(3, mdv[1]);
 }
 
+TEST_F(MappedDiskVectorTest, reserve_resizes_once) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  constexpr size_t N = 1000000;
+  mdv.reserve(N);
+  auto capacity = mdv.capacity();
+  EXPECT_GE(capacity, N);
+  EXPECT_LT(capacity, N + facebook::eden::detail::kPageSize / sizeof(U64));
+
+  struct stat st;
+  ASSERT_EQ(0, stat(mdvPath.c_str(), &st));
+  auto reservedSize = st.st_size;
+
+  for (uint64_t i = 0; i < N; ++i) {
+    mdv.emplace_back(i);
+  }
+  EXPECT_EQ(capacity, mdv.capacity());
+  ASSERT_EQ(0, stat(mdvPath.c_str(), &st));
+  EXPECT_EQ(reservedSize, st.st_size);
+
+  // Reserving less than the capacity is a no-op.
+  mdv.reserve(10);
+  EXPECT_EQ(capacity, mdv.capacity());
+}
+
+TEST_F(MappedDiskVectorTest, append_sized_range) {
+  std::vector<uint64_t> values(1000000);
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = i * 3;
+  }
+
+  {
+    auto mdv = MappedDiskVector<U64>::open(mdvPath);
+    mdv.emplace_back(42ull);
+    mdv.append(values);
+    EXPECT_EQ(values.size() + 1, mdv.size());
+    EXPECT_EQ(42, mdv[0]);
+    EXPECT_EQ(values.back(), mdv.back());
+  }
+
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  ASSERT_EQ(values.size() + 1, mdv.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(values[i], mdv[i + 1]);
+  }
+}
+
+TEST_F(MappedDiskVectorTest, append_input_range) {
+  std::string text;
+  constexpr uint64_t N = 100000;
+  for (uint64_t i = 0; i < N; ++i) {
+    text += fmt::format("{} ", i);
+  }
+  std::istringstream stream{text};
+
+  {
+    auto mdv = MappedDiskVector<U64>::open(mdvPath);
+    auto oldCapacity = mdv.capacity();
+    // A range whose size is unknown until it has been consumed.
+    struct {
+      std::istringstream& stream;
+      auto begin() const {
+        return std::istream_iterator<uint64_t>{stream};
+      }
+      auto end() const {
+        return std::istream_iterator<uint64_t>{};
+      }
+    } numbers{stream};
+    mdv.append(numbers);
+    EXPECT_EQ(N, mdv.size());
+    EXPECT_GT(mdv.capacity(), oldCapacity);
+  }
+
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  ASSERT_EQ(N, mdv.size());
+  EXPECT_EQ(0, mdv[0]);
+  EXPECT_EQ(N - 1, mdv.back());
+}
+
+TEST_F(MappedDiskVectorTest, growth_is_geometric) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  size_t resizes = 0;
+  auto capacity = mdv.capacity();
+  for (uint64_t i = 0; i < 10000000; ++i) {
+    mdv.emplace_back(i);
+    if (mdv.capacity() != capacity) {
+      EXPECT_GE(mdv.capacity(), capacity + capacity / 2);
+      capacity = mdv.capacity();
+      ++resizes;
+    }
+  }
+  // Growing in fixed steps of 1MB would take about 80 resizes.
+  EXPECT_LT(resizes, 20);
+}
+
+TEST_F(MappedDiskVectorTest, mapping_options_survive_growth) {
+  using facebook::eden::MappedDiskAccessPattern;
+  facebook::eden::MappedDiskOptions options;
+  options.populate = true;
+  options.willNeed = true;
+  options.hugePages = true;
+  options.accessPattern = MappedDiskAccessPattern::Random;
+  options.lockHeader = true;
+  options.lockedPrefixInBytes = 1 << 16;
+
+  {
+    auto mdv = MappedDiskVector<U64>::createOrOverwrite(mdvPath, options);
+    // Grow past the locked prefix and the initial mapping.
+    for (uint64_t i = 0; i < 1000000; ++i) {
+      mdv.emplace_back(i);
+    }
+    mdv.setAccessPattern(MappedDiskAccessPattern::Sequential);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < mdv.size(); ++i) {
+      sum += mdv[i].value;
+    }
+    EXPECT_EQ(999999ull * 1000000 / 2, sum);
+  }
+
+  auto mdv = MappedDiskVector<U64>::open(mdvPath, options);
+  ASSERT_EQ(1000000, mdv.size());
+  EXPECT_EQ(999999, mdv[999999].value);
+}
+
+namespace {
+facebook::eden::MappedDiskOptions checksummed(bool recover) {
+  facebook::eden::MappedDiskOptions options;
+  options.checksumHeader = true;
+  options.checksumRecords = true;
+  options.recover = recover;
+  return options;
+}
+
+void overwrite(const std::string& path, off_t offset, uint64_t value) {
+  folly::File file{path, O_RDWR};
+  ASSERT_EQ(
+      sizeof(value),
+      folly::pwriteNoInt(file.fd(), &value, sizeof(value), offset));
+}
+} // namespace
+
+TEST_F(MappedDiskVectorTest, header_checksum_recovers_entry_count) {
+  constexpr uint64_t N = 100000;
+  {
+    auto mdv = MappedDiskVector<U64>::open(mdvPath, checksummed(false));
+    for (uint64_t i = 0; i < N; ++i) {
+      mdv.emplace_back(i);
+    }
+  }
+
+  // As if the header reached the disk counting records that did not.
+  overwrite(mdvPath, offsetof(MappedDiskStorage::Header, entryCount), N + 10);
+
+  EXPECT_THROW(
+      MappedDiskVector<U64>::open(mdvPath, checksummed(false)),
+      std::runtime_error);
+
+  {
+    auto mdv = MappedDiskVector<U64>::open(mdvPath, checksummed(true));
+    ASSERT_EQ(N, mdv.size());
+    EXPECT_EQ(N - 1, mdv[N - 1].value);
+  }
+
+  // The recovered header is valid again.
+  auto mdv = MappedDiskVector<U64>::open(mdvPath, checksummed(false));
+  EXPECT_EQ(N, mdv.size());
+}
+
+TEST_F(MappedDiskVectorTest, record_checksums_truncate_to_valid_block) {
+  constexpr uint64_t N = 100000;
+  {
+    auto mdv = MappedDiskVector<U64>::open(mdvPath, checksummed(false));
+    for (uint64_t i = 0; i < N; ++i) {
+      mdv.emplace_back(i);
+    }
+    mdv.flush();
+  }
+
+  constexpr uint64_t kCorrupt = 70000;
+  overwrite(
+      mdvPath,
+      sizeof(MappedDiskStorage::Header) + kCorrupt * sizeof(U64),
+      12345);
+
+  auto mdv = MappedDiskVector<U64>::open(mdvPath, checksummed(true));
+  constexpr size_t kPerBlock =
+      MappedDiskStorage::kChecksumBlockSizeInBytes / sizeof(U64);
+  ASSERT_EQ(kCorrupt / kPerBlock * kPerBlock, mdv.size());
+  for (uint64_t i = 0; i < mdv.size(); ++i) {
+    ASSERT_EQ(i, mdv[i].value);
+  }
+}
+
+TEST_F(MappedDiskVectorTest, record_checksums_keep_records_flushed_in_block) {
+  {
+    auto mdv = MappedDiskVector<U64>::open(mdvPath, checksummed(false));
+    mdv.emplace_back(1ull);
+    mdv.emplace_back(2ull);
+  }
+
+  // As if a third record was appended, and the header written, but the
+  // process crashed before the checksums were updated.
+  overwrite(mdvPath, sizeof(MappedDiskStorage::Header) + 2 * sizeof(U64), 3);
+  overwrite(mdvPath, offsetof(MappedDiskStorage::Header, entryCount), 3);
+
+  auto mdv = MappedDiskVector<U64>::open(mdvPath, checksummed(true));
+  ASSERT_EQ(2, mdv.size());
+  EXPECT_EQ(1, mdv[0].value);
+  EXPECT_EQ(2, mdv[1].value);
+}
+
+// Without open file description locks, writers hold an exclusive flock and
+// read-only openers must wait for them to close the file.
+#ifdef F_OFD_SETLK
+TEST_F(MappedDiskVectorTest, read_only_sees_appends_after_refresh) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  for (uint64_t i = 0; i < 10; ++i) {
+    mdv.emplace_back(i);
+  }
+
+  auto snapshot = MappedDiskVector<U64>::openReadOnly(mdvPath);
+  EXPECT_TRUE(snapshot.readOnly());
+  ASSERT_EQ(10, snapshot.size());
+  EXPECT_EQ(9, snapshot[9].value);
+
+  // Grow the file several times over.
+  constexpr uint64_t N = 1000000;
+  for (uint64_t i = 10; i < N; ++i) {
+    mdv.emplace_back(i);
+  }
+  EXPECT_EQ(10, snapshot.size());
+  EXPECT_EQ(N, snapshot.refresh());
+  for (uint64_t i = 0; i < N; ++i) {
+    ASSERT_EQ(i, snapshot[i].value);
+  }
+
+  mdv.pop_back();
+  EXPECT_EQ(N - 1, snapshot.refresh());
+}
+
+TEST_F(MappedDiskVectorTest, writers_exclude_each_other) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  EXPECT_THROW(MappedDiskVector<U64>::open(mdvPath), std::system_error);
+  // Readers don't exclude each other.
+  auto first = MappedDiskVector<U64>::openReadOnly(mdvPath);
+  auto second = MappedDiskVector<U64>::openReadOnly(mdvPath);
+  EXPECT_EQ(0, second.size());
+}
+#endif
+
+TEST_F(MappedDiskVectorTest, read_only_rejects_missing_file) {
+  EXPECT_THROW(
+      MappedDiskVector<U64>::openReadOnly(mdvPath), std::system_error);
+}
+
+TEST_F(MappedDiskVectorTest, flush_in_every_durability_mode) {
+  using facebook::eden::MappedDiskDurability;
+  for (auto durability :
+       {MappedDiskDurability::None,
+        MappedDiskDurability::Async,
+        MappedDiskDurability::Strict}) {
+    {
+      auto mdv = MappedDiskVector<U64>::createOrOverwrite(mdvPath);
+      EXPECT_EQ(MappedDiskDurability::None, mdv.durability());
+      mdv.setDurability(durability);
+      EXPECT_EQ(durability, mdv.durability());
+
+      mdv.emplace_back(1ull);
+      mdv.flush();
+      // Flushing twice with nothing modified in between is fine.
+      mdv.flush();
+
+      std::vector<uint64_t> values(100000, 7);
+      mdv.append(values);
+      mdv[0] = U64{2};
+      mdv.flush();
+
+      mdv.pop_back();
+      mdv.flush();
+    }
+
+    auto mdv = MappedDiskVector<U64>::open(mdvPath);
+    ASSERT_EQ(100000, mdv.size());
+    EXPECT_EQ(2, mdv[0]);
+    EXPECT_EQ(7, mdv.back());
+  }
+}
+
+TEST_F(MappedDiskVectorTest, enabling_durability_after_writes) {
+  using facebook::eden::MappedDiskDurability;
+  {
+    auto mdv = MappedDiskVector<U64>::open(mdvPath);
+    mdv.emplace_back(1ull);
+    mdv.emplace_back(2ull);
+    // Writes made before tracking started are flushed too.
+    mdv.setDurability(MappedDiskDurability::Strict);
+    mdv.flush();
+  }
+
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  ASSERT_EQ(2, mdv.size());
+  EXPECT_EQ(1, mdv[0]);
+  EXPECT_EQ(2, mdv[1]);
+}
+
+TEST_F(MappedDiskVectorTest, strict_flush_with_dirty_first_and_later_pages) {
+  using facebook::eden::MappedDiskDurability;
+  {
+    auto mdv = MappedDiskVector<U64>::createOrOverwrite(mdvPath);
+    mdv.setDurability(MappedDiskDurability::Strict);
+    std::vector<uint64_t> values(10000, 7);
+    mdv.append(values);
+    mdv.flush();
+
+    // The first record shares its page with the header, the others don't.
+    mdv[0] = U64{1};
+    mdv[5000] = U64{2};
+    mdv.emplace_back(3ull);
+    mdv.flush();
+  }
+
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  ASSERT_EQ(10001, mdv.size());
+  EXPECT_EQ(1, mdv[0]);
+  EXPECT_EQ(7, mdv[1]);
+  EXPECT_EQ(2, mdv[5000]);
+  EXPECT_EQ(3, mdv.back());
+}
+
 namespace {
 struct Small {
   enum { VERSION = 0 };
@@ -231,6 +576,77 @@ TEST_F(MappedDiskVectorTest, migrates_across_multiple_versions) {
   }
 }
 
+TEST_F(MappedDiskVectorTest, storage_exposes_record_format_before_typing) {
+  {
+    auto mdv = MappedDiskVector<V2>::open(mdvPath);
+    mdv.emplace_back(V2{V1{7}});
+    mdv.emplace_back(V2{V1{8}});
+  }
+
+  auto storage = MappedDiskStorage::open(
+      mdvPath, MappedDiskVector<V4>::recordFormat());
+  EXPECT_EQ(V2::VERSION, storage.recordVersion());
+  EXPECT_EQ(sizeof(V2), storage.recordSize());
+  EXPECT_EQ(2, storage.entryCount());
+
+  // The caller picks the record type from the header.
+  MappedDiskVector<V2> mdv{std::move(storage)};
+  ASSERT_EQ(2, mdv.size());
+  EXPECT_EQ(7, mdv[0].value);
+  EXPECT_EQ(8, mdv[1].value);
+  mdv.emplace_back(V2{V1{9}});
+
+  // And may hand the mapping back to look at it differently.
+  storage = std::move(mdv).release();
+  EXPECT_EQ(3, storage.entryCount());
+  EXPECT_THROW(MappedDiskVector<V3>{std::move(storage)}, std::runtime_error);
+}
+
+TEST_F(MappedDiskVectorTest, storage_creates_file_in_requested_format) {
+  {
+    auto storage =
+        MappedDiskStorage::open(mdvPath, MappedDiskVector<V3>::recordFormat());
+    EXPECT_EQ(V3::VERSION, storage.recordVersion());
+    EXPECT_EQ(sizeof(V3), storage.recordSize());
+    EXPECT_EQ(0, storage.entryCount());
+    EXPECT_EQ(MappedDiskStorage::kInitialSizeInBytes, storage.sizeInBytes());
+  }
+
+  auto mdv = MappedDiskVector<V3>::open(mdvPath);
+  EXPECT_EQ(0, mdv.size());
+}
+
+TEST_F(MappedDiskVectorTest, migrates_in_parallel_with_progress) {
+  constexpr unsigned N = 100000;
+  {
+    auto mdv = MappedDiskVector<Old>::open(mdvPath);
+    for (unsigned i = 0; i < N; ++i) {
+      mdv.emplace_back(Old{i});
+    }
+  }
+
+  facebook::eden::MappedDiskMigrationOptions migrationOptions;
+  migrationOptions.threads = 4;
+  migrationOptions.chunkSize = 1000;
+  std::vector<size_t> progress;
+  migrationOptions.progress = [&](size_t converted, size_t total) {
+    EXPECT_EQ(N, total);
+    progress.push_back(converted);
+  };
+
+  auto mdv = MappedDiskVector<New>::open<Old>(
+      mdvPath, facebook::eden::MappedDiskOptions{}, migrationOptions);
+  ASSERT_EQ(N, mdv.size());
+  for (unsigned i = 0; i < N; ++i) {
+    ASSERT_EQ(i, mdv[i].y);
+    ASSERT_EQ(-i, mdv[i].x);
+  }
+
+  ASSERT_EQ(N / 1000, progress.size());
+  EXPECT_TRUE(std::is_sorted(progress.begin(), progress.end()));
+  EXPECT_EQ(N, progress.back());
+}
+
 TEST_F(MappedDiskVectorTest, migrate_overwrites_existing_tmp_file) {
   {
     auto mdv = MappedDiskVector<Old>::open(mdvPath);
@@ -250,4 +666,112 @@ TEST_F(MappedDiskVectorTest, migrate_overwrites_existing_tmp_file) {
   }
 }
 
+TEST_F(MappedDiskVectorTest, migrated_checksums_survive_a_crash) {
+  constexpr unsigned N = 100000;
+  {
+    auto mdv = MappedDiskVector<Old>::open(mdvPath, checksummed(false));
+    for (unsigned i = 0; i < N; ++i) {
+      mdv.emplace_back(Old{i});
+    }
+  }
+
+  // Migrate in a child that exits without closing the new vector.
+  auto pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    try {
+      auto mdv = MappedDiskVector<New>::open<Old>(mdvPath, checksummed(false));
+      _exit(mdv.size() == N ? 0 : 1);
+    } catch (const std::exception&) {
+      _exit(2);
+    }
+  }
+  int status = 0;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(0, WEXITSTATUS(status));
+
+  auto mdv = MappedDiskVector<New>::open(mdvPath, checksummed(true));
+  ASSERT_EQ(N, mdv.size());
+  for (unsigned i = 0; i < N; ++i) {
+    ASSERT_EQ(i, mdv[i].y);
+  }
+}
+
+TEST_F(MappedDiskVectorTest, concurrent_readers_during_appends) {
+  auto cmdv = ConcurrentMappedDiskVector<U64>::open(mdvPath, 64 << 20);
+  // Enough records to grow the file several times.
+  constexpr uint64_t N = 2000000;
+
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!done.load(std::memory_order_acquire)) {
+        size_t size = cmdv.size();
+        if (size == 0) {
+          continue;
+        }
+        ASSERT_EQ(size - 1, cmdv[size - 1].value);
+        ASSERT_EQ(size / 2, cmdv[size / 2].value);
+        auto records = cmdv.snapshot();
+        ASSERT_GE(records.size(), size);
+      }
+    });
+  }
+
+  const U64* first = nullptr;
+  for (uint64_t i = 0; i < N; ++i) {
+    cmdv.emplace_back(i);
+    if (!first) {
+      first = &cmdv[0];
+    }
+  }
+  std::vector<uint64_t> tail{N, N + 1, N + 2};
+  cmdv.append(tail);
+  done.store(true, std::memory_order_release);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+
+  // The mapping never moved.
+  EXPECT_EQ(first, &cmdv[0]);
+  EXPECT_EQ(N + 3, cmdv.size());
+}
+
+TEST_F(MappedDiskVectorTest, concurrent_vector_persists_records) {
+  {
+    auto cmdv = ConcurrentMappedDiskVector<U64>::createOrOverwrite(mdvPath);
+    cmdv.reserve(10);
+    EXPECT_GE(cmdv.capacity(), 10);
+    for (uint64_t i = 0; i < 10; ++i) {
+      cmdv.emplace_back(i);
+    }
+  }
+
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  ASSERT_EQ(10, mdv.size());
+  for (uint64_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(i, mdv[i].value);
+  }
+}
+
+TEST_F(MappedDiskVectorTest, concurrent_vector_stops_at_reservation) {
+  auto cmdv = ConcurrentMappedDiskVector<U64>::open(
+      mdvPath, MappedDiskStorage::kInitialSizeInBytes * 2);
+  size_t maxCapacity = cmdv.maxCapacity();
+  EXPECT_EQ(
+      (MappedDiskStorage::kInitialSizeInBytes * 2 -
+       sizeof(MappedDiskStorage::Header)) /
+          sizeof(U64),
+      maxCapacity);
+
+  for (uint64_t i = 0; i < maxCapacity; ++i) {
+    cmdv.emplace_back(i);
+  }
+  EXPECT_THROW(cmdv.emplace_back(0), std::length_error);
+  EXPECT_THROW(cmdv.append(std::vector<uint64_t>{0}), std::length_error);
+  EXPECT_EQ(maxCapacity, cmdv.size());
+}
+
 #endif
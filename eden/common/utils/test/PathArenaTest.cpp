@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/PathArena.h"
+
+#include <fmt/format.h>
+#include <folly/portability/GTest.h>
+#include <string>
+#include <vector>
+
+#include "eden/common/utils/PathMap.h"
+
+using namespace facebook::eden;
+using namespace facebook::eden::path_literals;
+
+TEST(PathArena, joinMatchesOperatorPlus) {
+  PathArena arena;
+  EXPECT_EQ(
+      "foo/bar"_relpath + "baz"_pc, arena.join("foo/bar"_relpath, "baz"_pc));
+  EXPECT_EQ("a/b/c/d"_relpath, arena.join("a/b"_relpath, "c/d"_relpath));
+  EXPECT_EQ("c/d"_relpath, arena.join(""_relpath, "c/d"_relpath));
+  EXPECT_EQ("a/b"_relpath, arena.join("a/b"_relpath, ""_relpath));
+  EXPECT_EQ("name"_relpath, arena.join(""_relpath, "name"_pc));
+  EXPECT_EQ(""_relpath, arena.copy(""_relpath));
+}
+
+TEST(PathArena, pathsOutliveTheirInputs) {
+  PathArena arena;
+  ArenaRelativePath path;
+  {
+    std::string dir{"some/dir"};
+    std::string name{"file.txt"};
+    path = arena.join(RelativePathPiece{dir}, PathComponentPiece{name});
+    dir.assign(dir.size(), 'x');
+    name.assign(name.size(), 'y');
+  }
+  EXPECT_EQ("some/dir/file.txt"_relpath, path);
+  EXPECT_EQ(path.view().size(), arena.bytesUsed());
+}
+
+TEST(PathArena, bulkTraversal) {
+  PathArena arena{128};
+  std::vector<ArenaRelativePath> paths;
+  std::vector<RelativePath> expected;
+  ArenaRelativePath dir;
+  RelativePath expectedDir;
+  for (int depth = 0; depth < 10; ++depth) {
+    for (int i = 0; i < 50; ++i) {
+      auto name = PathComponent{fmt::format("file{}", i)};
+      paths.push_back(arena.join(dir, name));
+      expected.push_back(expectedDir + name);
+    }
+    auto dirName = PathComponent{fmt::format("dir{}", depth)};
+    dir = arena.join(dir, dirName);
+    expectedDir = expectedDir + dirName;
+  }
+
+  ASSERT_EQ(expected.size(), paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    EXPECT_EQ(expected[i], paths[i]);
+    EXPECT_EQ(
+        std::hash<RelativePathPiece>{}(expected[i]),
+        std::hash<RelativePathPiece>{}(paths[i]));
+  }
+
+  arena.release();
+  EXPECT_EQ(0, arena.bytesUsed());
+  EXPECT_EQ("x/y"_relpath, arena.join("x"_relpath, "y"_pc));
+}
+
+TEST(PathArena, pathMapKeys) {
+  PathArena arena;
+  PathMap<int, ArenaRelativePath> map{CaseSensitivity::Sensitive};
+  map.emplace(arena.join("dir"_relpath, "b"_pc), 2);
+  map.emplace(arena.join("dir"_relpath, "a"_pc), 1);
+  EXPECT_EQ(2, map.size());
+  EXPECT_EQ(1, map.at("dir/a"_relpath));
+  EXPECT_EQ(2, map.at("dir/b"_relpath));
+  EXPECT_EQ("dir/a"_relpath, map.begin()->first);
+}
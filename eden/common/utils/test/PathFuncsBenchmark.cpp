@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/PathFuncs.h"
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+using namespace facebook::eden;
+
+/**
+ * The checks performed by PathComponentSanityCheck before it was vectorized:
+ * a scan for forbidden bytes followed by a separate UTF-8 validation pass.
+ */
+bool scalarIsValidPathComponent(std::string_view name) {
+  for (auto c : name) {
+    if (detail::isDirSeparator(c) || c == '\0') {
+      return false;
+    }
+  }
+  if (name.empty() || name == "." || name == "..") {
+    return false;
+  }
+  return isValidUtf8(name);
+}
+
+bool scalarIsValidRelativePath(std::string_view path) {
+  size_t start = 0;
+  while (true) {
+    auto next = detail::findPathSeparator(path, start);
+    if (next == std::string_view::npos) {
+      return scalarIsValidPathComponent(path.substr(start));
+    }
+    if (!scalarIsValidPathComponent(path.substr(start, next - start))) {
+      return false;
+    }
+    start = next + 1;
+  }
+}
+
+/**
+ * Builds file names resembling the contents of a source repository: a few
+ * very common basenames, short identifiers with extensions, long generated
+ * names and a small fraction of non-ASCII names.
+ */
+std::vector<std::string> makeFileNames(size_t count) {
+  static const char* const kCommon[] = {
+      "src",
+      "BUCK",
+      "TARGETS",
+      "__init__.py",
+      "test",
+      "README.md",
+      "CMakeLists.txt",
+      "index.js",
+  };
+  static const char* const kExtensions[] = {
+      ".cpp", ".h", ".py", ".rs", ".js", ".json", ".thrift", ""};
+  static const char* const kNonAscii[] = {
+      "r\xc3\xa9sum\xc3\xa9.txt",
+      "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e.md",
+      "caf\xc3\xa9",
+  };
+
+  std::mt19937 rng{0};
+  auto identifier = [&](size_t length) {
+    std::string name;
+    for (size_t i = 0; i < length; ++i) {
+      name.push_back("abcdefghijklmnopqrstuvwxyz_0123456789"[rng() % 37]);
+    }
+    return name;
+  };
+
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto kind = rng() % 100;
+    if (kind < 30) {
+      names.emplace_back(kCommon[rng() % std::size(kCommon)]);
+    } else if (kind < 85) {
+      names.push_back(
+          identifier(3 + rng() % 14) +
+          kExtensions[rng() % std::size(kExtensions)]);
+    } else if (kind < 98) {
+      names.push_back(identifier(24 + rng() % 40));
+    } else {
+      names.emplace_back(kNonAscii[rng() % std::size(kNonAscii)]);
+    }
+  }
+  return names;
+}
+
+std::vector<std::string> makeRelativePaths(size_t count) {
+  auto names = makeFileNames(count * 4);
+  std::mt19937 rng{1};
+  std::vector<std::string> paths;
+  paths.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::string path = names[rng() % names.size()];
+    auto depth = 1 + rng() % 10;
+    for (size_t j = 0; j < depth; ++j) {
+      path += kDirSeparatorStr;
+      path += names[rng() % names.size()];
+    }
+    paths.push_back(std::move(path));
+  }
+  return paths;
+}
+
+constexpr size_t kCorpusSize = 4096;
+
+void PathComponent_scalar_sanity_check(benchmark::State& state) {
+  auto names = makeFileNames(kCorpusSize);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        scalarIsValidPathComponent(names[i++ % kCorpusSize]));
+  }
+}
+BENCHMARK(PathComponent_scalar_sanity_check);
+
+void PathComponent_sanity_check(benchmark::State& state) {
+  auto names = makeFileNames(kCorpusSize);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        detail::isValidPathComponent(names[i++ % kCorpusSize]));
+  }
+}
+BENCHMARK(PathComponent_sanity_check);
+
+void RelativePath_scalar_sanity_check(benchmark::State& state) {
+  auto paths = makeRelativePaths(kCorpusSize);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        scalarIsValidRelativePath(paths[i++ % kCorpusSize]));
+  }
+}
+BENCHMARK(RelativePath_scalar_sanity_check);
+
+void RelativePath_sanity_check(benchmark::State& state) {
+  auto paths = makeRelativePaths(kCorpusSize);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        detail::isValidComposedPath(paths[i++ % kCorpusSize], std::nullopt));
+  }
+}
+BENCHMARK(RelativePath_sanity_check);
+
+/**
+ * Absolute versions of makeRelativePaths(), as canonicalPath() produces them.
+ */
+std::vector<std::string> makeCanonicalPaths(size_t count) {
+  auto paths = makeRelativePaths(count);
+  for (auto& path : paths) {
+    path = fmt::format("{}{}", detail::kRootStr, path);
+    if (folly::kIsWindows) {
+      std::replace(path.begin(), path.end(), '/', kAbsDirSeparator);
+    }
+  }
+  return paths;
+}
+
+/**
+ * Paths that need normalizing: doubled separators, "." and ".." components.
+ */
+std::vector<std::string> makeUntidyPaths(size_t count) {
+  auto paths = makeCanonicalPaths(count);
+  std::mt19937 rng{2};
+  for (auto& path : paths) {
+    auto pos = path.rfind(kAbsDirSeparator);
+    switch (rng() % 3) {
+      case 0:
+        path.insert(pos, 1, kAbsDirSeparator);
+        break;
+      case 1:
+        path.insert(pos, fmt::format("{}.", kAbsDirSeparator));
+        break;
+      case 2:
+        path.insert(
+            pos, fmt::format("{}x{}..", kAbsDirSeparator, kAbsDirSeparator));
+        break;
+    }
+  }
+  return paths;
+}
+
+void canonicalPath_canonical(benchmark::State& state) {
+  auto paths = makeCanonicalPaths(kCorpusSize);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(canonicalPath(paths[i++ % kCorpusSize]));
+  }
+}
+BENCHMARK(canonicalPath_canonical);
+
+void canonicalPath_untidy(benchmark::State& state) {
+  auto paths = makeUntidyPaths(kCorpusSize);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(canonicalPath(paths[i++ % kCorpusSize]));
+  }
+}
+BENCHMARK(canonicalPath_untidy);
+
+void canonicalPath_relative_to_base(benchmark::State& state) {
+  auto paths = makeRelativePaths(kCorpusSize);
+  if (folly::kIsWindows) {
+    for (auto& path : paths) {
+      std::replace(path.begin(), path.end(), '/', kAbsDirSeparator);
+    }
+  }
+  auto base = canonicalPath(makeCanonicalPaths(1)[0]);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(canonicalPath(paths[i++ % kCorpusSize], base));
+  }
+}
+BENCHMARK(canonicalPath_relative_to_base);
+
+void joinAndNormalize_normalized(benchmark::State& state) {
+  auto paths = makeRelativePaths(kCorpusSize);
+  auto base = RelativePath{makeRelativePaths(1)[0]};
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(joinAndNormalize(base, paths[i++ % kCorpusSize]));
+  }
+}
+BENCHMARK(joinAndNormalize_normalized);
+
+void joinAndNormalize_untidy(benchmark::State& state) {
+  auto paths = makeRelativePaths(kCorpusSize);
+  std::mt19937 rng{3};
+  for (auto& path : paths) {
+    auto pos = path.rfind('/');
+    path.insert(pos, rng() % 2 ? "/." : "//");
+  }
+  auto base = RelativePath{makeRelativePaths(1)[0]};
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(joinAndNormalize(base, paths[i++ % kCorpusSize]));
+  }
+}
+BENCHMARK(joinAndNormalize_untidy);
+
+/**
+ * Pairs of names that only differ by case after a shared prefix, as compared
+ * by a case-insensitive PathMap lookup that ends on a match.
+ */
+std::vector<std::pair<std::string, std::string>> makeCaseFoldedPairs(
+    size_t count,
+    size_t prefixLength) {
+  auto names = makeFileNames(count);
+  std::mt19937 rng{4};
+  std::vector<std::pair<std::string, std::string>> pairs;
+  pairs.reserve(count);
+  for (auto& name : names) {
+    name = std::string(prefixLength, 'p') + name;
+    auto folded = name;
+    for (auto& c : folded) {
+      if (c >= 'a' && c <= 'z' && rng() % 2) {
+        c -= 'a' - 'A';
+      }
+    }
+    pairs.emplace_back(std::move(name), std::move(folded));
+  }
+  return pairs;
+}
+
+void compare_case_insensitive_scalar(benchmark::State& state) {
+  auto pairs = makeCaseFoldedPairs(kCorpusSize, state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto& [a, b] = pairs[i++ % kCorpusSize];
+    benchmark::DoNotOptimize(std::lexicographical_compare(
+        a.begin(),
+        a.end(),
+        b.begin(),
+        b.end(),
+        AsciiLessThanCaseInsensitive{}));
+  }
+}
+BENCHMARK(compare_case_insensitive_scalar)->Arg(0)->Arg(32)->Arg(128);
+
+void compare_case_insensitive(benchmark::State& state) {
+  auto pairs = makeCaseFoldedPairs(kCorpusSize, state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto& [a, b] = pairs[i++ % kCorpusSize];
+    benchmark::DoNotOptimize(detail::compareAsciiCaseInsensitive(a, b) < 0);
+  }
+}
+BENCHMARK(compare_case_insensitive)->Arg(0)->Arg(32)->Arg(128);
+
+} // namespace
@@ -69,6 +69,50 @@ TEST(PathFuncs, Sanity) {
   }
 }
 
+TEST(PathFuncs, SanityAcrossChunkBoundaries) {
+  // The runtime validators process their input in 16 and 32 byte chunks.
+  // Make sure that invalid bytes and components are detected wherever they
+  // fall relative to those chunks.
+  for (size_t len = 1; len < 80; ++len) {
+    std::string name(len, 'a');
+    EXPECT_NO_THROW(PathComponentPiece{name});
+
+    for (size_t pos = 0; pos < len; ++pos) {
+      auto withSeparator = name;
+      withSeparator[pos] = '/';
+      EXPECT_THROW(
+          PathComponentPiece{withSeparator},
+          PathComponentContainsDirectorySeparator);
+
+      auto withNul = name;
+      withNul[pos] = '\0';
+      EXPECT_THROW(PathComponentPiece{withNul}, PathComponentValidationError);
+
+      auto withInvalidUtf8 = name;
+      withInvalidUtf8[pos] = '\xff';
+      EXPECT_THROW(PathComponentPiece{withInvalidUtf8}, PathComponentNotUtf8);
+    }
+
+    EXPECT_NO_THROW(RelativePathPiece{name + "/b"});
+    EXPECT_NO_THROW(RelativePathPiece{name + "/.b/..c"});
+    EXPECT_NO_THROW(RelativePathPiece{name + "/\xc3\xa9t\xc3\xa9"});
+    EXPECT_THROW(RelativePathPiece{name + "/./b"}, std::domain_error);
+    EXPECT_THROW(RelativePathPiece{name + "/../b"}, std::domain_error);
+    EXPECT_THROW(RelativePathPiece{name + "//b"}, std::domain_error);
+    EXPECT_THROW(RelativePathPiece{name + "/b/."}, std::domain_error);
+    EXPECT_THROW(RelativePathPiece{name + "/\xc3"}, std::domain_error);
+    EXPECT_THROW(RelativePathPiece{name + "/\xc3/b"}, std::domain_error);
+
+    EXPECT_NO_THROW(
+        detail::AbsolutePathSanityCheck{}(
+            fmt::format("{}{}", detail::kRootStr, name)));
+    EXPECT_THROW(
+        detail::AbsolutePathSanityCheck{}(
+            fmt::format("{}{}{}..", detail::kRootStr, name, kAbsDirSeparator)),
+        std::domain_error);
+  }
+}
+
 TEST(PathFuncs, StringCompare) {
   PathComponentPiece piece("foo");
 
@@ -937,6 +981,21 @@ TEST(PathFuncs, canonicalPath) {
                         : "/base/dir/path/.../test",
       canonicalPath(".../test", base).value());
 
+  // Inputs that are already canonical are copied as-is, but a base that
+  // isn't canonical still gets normalized.
+  auto root = AbsolutePath{detail::kRootStr, detail::SkipPathSanityCheck{}};
+  EXPECT_EQ(
+      folly::kIsWindows ? "\\\\?\\abc\\def" : "/abc/def",
+      canonicalPath("abc/def", root).value());
+  auto untidyBase = AbsolutePath{
+      folly::kIsWindows ? "\\\\?\\base\\\\dir" : "/base//dir",
+      detail::SkipPathSanityCheck{}};
+  EXPECT_EQ(
+      folly::kIsWindows ? "\\\\?\\base\\dir\\abc" : "/base/dir/abc",
+      canonicalPath("abc", untidyBase).value());
+  EXPECT_ANY_THROW(canonicalPath("/foo/\xff/bar"));
+  EXPECT_ANY_THROW(canonicalPath("\xff", base));
+
   // TODO(T66260288): These tests currently do not pass on Windows, as
   // canonicalPath() incorrectly tries to put a leading slash on the paths.
   // e.g., "C:/foo" ends up being converted to "/C:/foo"
@@ -965,6 +1024,9 @@ TEST(PathFuncs, joinAndNormalize) {
   EXPECT_EQ(good("", "a/b"), RelativePath{"a/b"});
   EXPECT_EQ(good("a/b", "../.."), RelativePath{""});
   EXPECT_EQ(good("a/b/c", "../.."), RelativePath{"a"});
+  EXPECT_EQ(good("a", "b/c/d"), RelativePath{"a/b/c/d"});
+  EXPECT_EQ(good("a", "b//c/"), RelativePath{"a/b/c"});
+  EXPECT_EQ(good("a", "./b"), RelativePath{"a/b"});
 
   EXPECT_EQ(bad("a", "/b/c"), EPERM);
   EXPECT_EQ(bad("a/b/c", "/"), EPERM);
@@ -1183,6 +1245,55 @@ TEST(PathFuncs, comparisonInsensitive) {
   EXPECT_EQ(result, CompareResult::AFTER);
 }
 
+TEST(PathFuncs, comparisonInsensitiveAcrossChunkBoundaries) {
+  // compareAsciiCaseInsensitive() processes its input in 16 and 32 byte
+  // chunks. Check it agrees with the scalar comparator wherever the first
+  // difference falls.
+  auto expected = [](std::string_view a, std::string_view b) {
+    bool less = std::lexicographical_compare(
+        a.begin(), a.end(), b.begin(), b.end(), AsciiLessThanCaseInsensitive{});
+    bool greater = std::lexicographical_compare(
+        b.begin(), b.end(), a.begin(), a.end(), AsciiLessThanCaseInsensitive{});
+    return less ? -1 : (greater ? 1 : 0);
+  };
+  auto sign = [](int value) { return (value > 0) - (value < 0); };
+
+  for (size_t len = 0; len < 80; ++len) {
+    std::string lower;
+    for (size_t i = 0; i < len; ++i) {
+      lower.push_back("abcxyz_.09"[i % 10]);
+    }
+    std::string upper = lower;
+    for (auto& c : upper) {
+      if (c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+      }
+    }
+    EXPECT_EQ(0, detail::compareAsciiCaseInsensitive(lower, upper));
+    EXPECT_TRUE(detail::equalAsciiCaseInsensitive(lower, upper));
+    EXPECT_GT(0, detail::compareAsciiCaseInsensitive(lower, upper + "a"));
+    EXPECT_LT(0, detail::compareAsciiCaseInsensitive(lower + "A", upper));
+
+    for (size_t pos = 0; pos < len; ++pos) {
+      for (char c : {'@', '[', '`', '{', 'Q', 'q', '\x7f', '\x80', '\xc3'}) {
+        auto changed = upper;
+        changed[pos] = c;
+        SCOPED_TRACE(fmt::format(
+            "len={} pos={} c={:#x}", len, pos, static_cast<unsigned char>(c)));
+        EXPECT_EQ(
+            expected(lower, changed),
+            sign(detail::compareAsciiCaseInsensitive(lower, changed)));
+        EXPECT_EQ(
+            expected(changed, lower),
+            sign(detail::compareAsciiCaseInsensitive(changed, lower)));
+        EXPECT_EQ(
+            expected(lower, changed) == 0,
+            detail::equalAsciiCaseInsensitive(lower, changed));
+      }
+    }
+  }
+}
+
 TEST(PathFuncs, localDirCreateRemove) {
   folly::test::TemporaryDirectory dir = makeTempDir();
   string pathStr{dir.path().string()};
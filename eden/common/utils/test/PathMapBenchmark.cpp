@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/PathMap.h"
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+using namespace facebook::eden;
+
+constexpr size_t kLookups = 4096;
+
+/**
+ * Builds a directory of `size` entries named like generated source
+ * files, which share long prefixes, and a list of names to look up in it.
+ * Case-insensitive lookups use names whose case differs from the stored one.
+ */
+struct Directory {
+  Directory(size_t size, CaseSensitivity caseSensitive) : map{caseSensitive} {
+    std::mt19937 rng{0};
+    std::vector<std::string> names;
+    for (size_t i = 0; i < size; ++i) {
+      names.push_back(fmt::format("GeneratedSourceFile_{:08}.cpp", rng()));
+      map.emplace(PathComponent{names.back()}, static_cast<int>(i));
+    }
+    for (size_t i = 0; i < kLookups; ++i) {
+      auto name = names[rng() % names.size()];
+      if (caseSensitive == CaseSensitivity::Insensitive) {
+        for (auto& c : name) {
+          if (c >= 'a' && c <= 'z') {
+            c -= 'a' - 'A';
+          }
+        }
+      }
+      lookups.emplace_back(std::move(name));
+    }
+  }
+
+  PathMap<int> map;
+  std::vector<PathComponent> lookups;
+};
+
+void PathMap_find(benchmark::State& state, CaseSensitivity caseSensitive) {
+  Directory dir{static_cast<size_t>(state.range(0)), caseSensitive};
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dir.map.find(dir.lookups[i++ % kLookups]));
+  }
+}
+
+void PathMap_find_sensitive(benchmark::State& state) {
+  PathMap_find(state, CaseSensitivity::Sensitive);
+}
+BENCHMARK(PathMap_find_sensitive)->Arg(16)->Arg(256)->Arg(4096);
+
+void PathMap_find_insensitive(benchmark::State& state) {
+  PathMap_find(state, CaseSensitivity::Insensitive);
+}
+BENCHMARK(PathMap_find_insensitive)->Arg(16)->Arg(256)->Arg(4096);
+
+} // namespace
@@ -6,8 +6,12 @@
  */
 
 #include "eden/common/utils/PathMap.h"
+#include "eden/common/utils/SmallPathMap.h"
 #include <folly/portability/GTest.h>
 #include <folly/portability/Unistd.h>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
 
 using namespace facebook::eden;
 using namespace facebook::eden::path_literals;
@@ -415,3 +419,189 @@ TEST(PathMapTest, vecConstructorInsensitive) {
     ASSERT_EQ(1, m.size());
   }
 }
+
+TEST(PathMapTest, mergeSorted) {
+  auto m = PathMap<int>{
+      {{PathComponent{"b"}, 1}, {PathComponent{"d"}, 2}},
+      CaseSensitivity::Sensitive};
+
+  folly::fbvector<std::pair<PathComponent, int>> batch{
+      {PathComponent{"a"}, 10},
+      {PathComponent{"b"}, 11},
+      {PathComponent{"c"}, 12},
+      {PathComponent{"c"}, 13},
+      {PathComponent{"e"}, 14},
+  };
+  EXPECT_EQ(3, m.mergeSorted(batch));
+
+  auto expected = PathMap<int>{
+      {{PathComponent{"a"}, 10},
+       {PathComponent{"b"}, 1},
+       {PathComponent{"c"}, 12},
+       {PathComponent{"d"}, 2},
+       {PathComponent{"e"}, 14}},
+      CaseSensitivity::Sensitive};
+  EXPECT_EQ(expected, m);
+
+  // Appending past the end.
+  folly::fbvector<std::pair<PathComponent, int>> tail{
+      {PathComponent{"f"}, 15},
+      {PathComponent{"f"}, 16},
+      {PathComponent{"g"}, 17},
+  };
+  EXPECT_EQ(2, m.mergeSorted(std::move(tail)));
+  EXPECT_EQ(7, m.size());
+  EXPECT_EQ(15, m.at("f"_pc));
+  EXPECT_EQ(17, m.at("g"_pc));
+}
+
+TEST(PathMapTest, mergeSortedInsensitive) {
+  auto m = PathMap<bool>{CaseSensitivity::Insensitive};
+  m.emplace(PathComponent{"HELLO"}, true);
+
+  folly::fbvector<std::pair<PathComponent, bool>> batch{
+      {PathComponent{"abc"}, false},
+      {PathComponent{"ABC"}, true},
+      {PathComponent{"hello"}, false},
+      {PathComponent{"World"}, false},
+      {PathComponent{"world"}, true},
+  };
+  EXPECT_EQ(2, m.mergeSorted(batch));
+  EXPECT_EQ(3, m.size());
+  EXPECT_EQ(false, m.at("Abc"_pc));
+  EXPECT_EQ("abc"_pc, m.find("ABC"_pc)->first);
+  EXPECT_EQ(true, m.at("hello"_pc));
+  EXPECT_EQ("HELLO"_pc, m.find("hello"_pc)->first);
+  EXPECT_EQ(false, m.at("WORLD"_pc));
+}
+
+TEST(PathMapTest, mergeSortedRejectsUnsortedBatch) {
+  auto m = PathMap<int>{
+      {{PathComponent{"b"}, 1}, {PathComponent{"d"}, 2}},
+      CaseSensitivity::Sensitive};
+  auto before = m;
+
+  folly::fbvector<std::pair<PathComponent, int>> batch{
+      {PathComponent{"c"}, 10},
+      {PathComponent{"a"}, 11},
+  };
+  EXPECT_THROW(m.mergeSorted(batch), std::invalid_argument);
+  EXPECT_EQ(before, m);
+}
+
+namespace {
+// Copies of a value with `throwOnCopy` set throw.
+struct ThrowingCopy {
+  explicit ThrowingCopy(int v, bool t = false) : value{v}, throwOnCopy{t} {}
+  ThrowingCopy(const ThrowingCopy& other)
+      : value{other.value}, throwOnCopy{other.throwOnCopy} {
+    if (throwOnCopy) {
+      throw std::runtime_error("copy");
+    }
+  }
+  ThrowingCopy(ThrowingCopy&&) noexcept = default;
+  ThrowingCopy& operator=(const ThrowingCopy&) = default;
+  ThrowingCopy& operator=(ThrowingCopy&&) noexcept = default;
+
+  int value;
+  bool throwOnCopy;
+};
+} // namespace
+
+TEST(PathMapTest, mergeSortedLeavesMapUnchangedOnThrow) {
+  auto m = PathMap<ThrowingCopy>{CaseSensitivity::Sensitive};
+  m.emplace(PathComponent{"b"}, 1);
+  m.emplace(PathComponent{"d"}, 2);
+
+  for (auto throwingKey : {"c", "e"}) {
+    folly::fbvector<std::pair<PathComponent, ThrowingCopy>> batch;
+    for (auto key : {"a", "c", "e"}) {
+      batch.emplace_back(
+          PathComponent{key},
+          ThrowingCopy{0, std::string_view{key} == throwingKey});
+    }
+    EXPECT_THROW(m.mergeSorted(batch), std::runtime_error);
+    ASSERT_EQ(2, m.size());
+    EXPECT_EQ(1, m.at("b"_pc).value);
+    EXPECT_EQ(2, m.at("d"_pc).value);
+  }
+
+  // The append path too.
+  folly::fbvector<std::pair<PathComponent, ThrowingCopy>> tail;
+  tail.emplace_back(PathComponent{"f"}, ThrowingCopy{3});
+  tail.emplace_back(PathComponent{"g"}, ThrowingCopy{4, true});
+  EXPECT_THROW(m.mergeSorted(tail), std::runtime_error);
+  EXPECT_EQ(2, m.size());
+  EXPECT_EQ(m.end(), m.find("f"_pc));
+}
+
+TEST(PathMapTest, eraseSorted) {
+  auto m = PathMap<int>{
+      {{PathComponent{"a"}, 1},
+       {PathComponent{"B"}, 2},
+       {PathComponent{"c"}, 3},
+       {PathComponent{"D"}, 4}},
+      CaseSensitivity::Insensitive};
+
+  std::vector<PathComponentPiece> keys{"b"_pc, "bb"_pc, "C"_pc, "z"_pc};
+  EXPECT_EQ(2, m.eraseSorted(keys));
+
+  auto expected = PathMap<int>{
+      {{PathComponent{"a"}, 1}, {PathComponent{"D"}, 4}},
+      CaseSensitivity::Insensitive};
+  EXPECT_EQ(expected, m);
+
+  std::vector<PathComponentPiece> unsorted{"d"_pc, "a"_pc};
+  EXPECT_THROW(m.eraseSorted(unsorted), std::invalid_argument);
+  EXPECT_EQ(expected, m);
+}
+
+namespace {
+template <typename Map>
+bool isStorageInline(const Map& map) {
+  const void* begin = &map;
+  const void* end = &map + 1;
+  const void* data = &*map.begin();
+  return std::less_equal<const void*>{}(begin, data) &&
+      std::less<const void*>{}(data, end);
+}
+} // namespace
+
+TEST(PathMapTest, smallPathMapStaysInline) {
+  SmallPathMap<int, 4> map{CaseSensitivity::Insensitive};
+  EXPECT_EQ(4, map.capacity());
+  map["d"_pc] = 4;
+  map["b"_pc] = 2;
+  map["C"_pc] = 3;
+  map["a"_pc] = 1;
+  EXPECT_TRUE(isStorageInline(map));
+  EXPECT_EQ(4, map.size());
+  EXPECT_EQ(3, map.at("c"_pc));
+  EXPECT_EQ("a"_pc, map.begin()->first);
+
+  // Spills to the heap past N entries.
+  map["e"_pc] = 5;
+  EXPECT_FALSE(isStorageInline(map));
+  EXPECT_EQ(5, map.at("E"_pc));
+  EXPECT_EQ(1, map.erase("A"_pc));
+  EXPECT_EQ(4, map.size());
+}
+
+TEST(PathMapTest, smallPathMapCopyMoveAndVecConstructor) {
+  folly::small_vector<std::pair<PathComponent, bool>, 8> vec{
+      {PathComponent{"zebra"}, true},
+      {PathComponent{"aardvark"}, false},
+      {PathComponent{"Zebra"}, false},
+  };
+  auto map = SmallPathMap<bool>{std::move(vec), CaseSensitivity::Insensitive};
+  EXPECT_EQ(2, map.size());
+  EXPECT_TRUE(map.at("ZEBRA"_pc));
+
+  auto copy = map;
+  EXPECT_EQ(map, copy);
+  EXPECT_TRUE(isStorageInline(copy));
+
+  auto moved = std::move(copy);
+  EXPECT_EQ(map, moved);
+  EXPECT_EQ(CaseSensitivity::Insensitive, moved.getCaseSensitivity());
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "eden/common/utils/Utf8.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+namespace {
+
+using namespace facebook::eden;
+
+std::string makeAscii(size_t size) {
+  std::mt19937 rng{0};
+  std::string str;
+  for (size_t i = 0; i < size; ++i) {
+    str.push_back(static_cast<char>(' ' + rng() % 95));
+  }
+  return str;
+}
+
+/**
+ * Mostly ASCII with regular 2, 3 and 4 byte sequences, like a path or log
+ * message that contains some non-English words.
+ */
+std::string makeMixed(size_t size) {
+  static const char* const kSequences[] = {
+      "\xc3\xa9", "\xe6\x97\xa5", "\xf0\x9f\x98\x80"};
+  std::mt19937 rng{1};
+  std::string str;
+  while (str.size() < size) {
+    if (rng() % 8 == 0) {
+      str += kSequences[rng() % std::size(kSequences)];
+    } else {
+      str.push_back(static_cast<char>(' ' + rng() % 95));
+    }
+  }
+  return str;
+}
+
+/**
+ * Valid mixed input with a single stray continuation byte at the end, so that
+ * the whole input has to be scanned.
+ */
+std::string makeInvalid(size_t size) {
+  auto str = makeMixed(size);
+  str.back() = '\x80';
+  return str;
+}
+
+template <std::string (*makeInput)(size_t), bool (*isValid)(folly::StringPiece)>
+void validate(benchmark::State& state) {
+  auto str = makeInput(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(isValid(str));
+  }
+  state.SetBytesProcessed(state.iterations() * str.size());
+}
+
+bool constexprImpl(folly::StringPiece str) {
+  return detail::isValidUtf8Constexpr(str);
+}
+
+bool runtimeImpl(folly::StringPiece str) {
+  return detail::isValidUtf8Runtime(str);
+}
+
+BENCHMARK(validate<makeAscii, constexprImpl>)
+    ->Name("isValidUtf8_constexpr_ascii")
+    ->Range(16, 4096);
+BENCHMARK(validate<makeAscii, runtimeImpl>)
+    ->Name("isValidUtf8_runtime_ascii")
+    ->Range(16, 4096);
+BENCHMARK(validate<makeMixed, constexprImpl>)
+    ->Name("isValidUtf8_constexpr_mixed")
+    ->Range(16, 4096);
+BENCHMARK(validate<makeMixed, runtimeImpl>)
+    ->Name("isValidUtf8_runtime_mixed")
+    ->Range(16, 4096);
+BENCHMARK(validate<makeInvalid, constexprImpl>)
+    ->Name("isValidUtf8_constexpr_invalid")
+    ->Range(16, 4096);
+BENCHMARK(validate<makeInvalid, runtimeImpl>)
+    ->Name("isValidUtf8_runtime_invalid")
+    ->Range(16, 4096);
+
+} // namespace
@@ -6,6 +6,8 @@
  */
 
 #include "eden/common/utils/Utf8.h"
+
+#include <folly/String.h>
 #include <folly/portability/GTest.h>
 
 using namespace facebook::eden;
@@ -35,6 +37,59 @@ TEST(Utf8Test, isValidUtf8) {
   EXPECT_FALSE(isValidUtf8("\xA0prefix\xB0"));
 }
 
+static_assert(isValidUtf8("abc"));
+static_assert(!isValidUtf8("\xff"));
+
+TEST(Utf8Test, isValidUtf8DoesNotReadPastTheEnd) {
+  // A truncated sequence followed by a continuation byte outside of the
+  // validated range.
+  folly::StringPiece buffer{"a\xc3\xa9"};
+  EXPECT_TRUE(isValidUtf8(buffer));
+  EXPECT_FALSE(isValidUtf8(buffer.subpiece(0, 2)));
+  EXPECT_FALSE(detail::isValidUtf8Constexpr(buffer.subpiece(0, 2)));
+}
+
+TEST(Utf8Test, isValidUtf8AcceptsSurrogatesAndLargeCodepoints) {
+  // Surrogates and code points past U+10FFFF are accepted, as long as they
+  // are encoded in at most 4 bytes.
+  EXPECT_TRUE(isValidUtf8("\xed\xa0\x80"));
+  EXPECT_TRUE(isValidUtf8("\xf4\x90\x80\x80"));
+  EXPECT_TRUE(isValidUtf8("\xf7\xbf\xbf\xbf"));
+  EXPECT_FALSE(isValidUtf8("\xf8\x88\x80\x80\x80"));
+}
+
+TEST(Utf8Test, isValidUtf8MatchesConstexprAcrossChunks) {
+  // The runtime validator works on 16 and 32 byte chunks. Place each sequence
+  // at every offset around the chunk boundaries and check that it agrees with
+  // the scalar implementation.
+  const folly::StringPiece sequences[] = {
+      "\xc2\x80",
+      "\xdf\xbf",
+      "\xe0\xa0\x80",
+      "\xef\xbf\xbf",
+      "\xf0\x90\x80\x80",
+      "\xc0\x80",
+      "\xe0\x9f\xbf",
+      "\xf0\x8f\xbf\xbf",
+      "\x80",
+      "\xc3",
+      "\xe2\x82",
+      "\xf0\x9f\x98",
+      "\xc3\xa9\xa9",
+      "\xf8\x80\x80\x80\x80",
+  };
+  for (auto sequence : sequences) {
+    for (size_t prefix = 0; prefix < 70; ++prefix) {
+      for (size_t suffix : {0, 1, 5, 40}) {
+        auto str = std::string(prefix, 'a') + sequence.str() +
+            std::string(suffix, 'b');
+        EXPECT_EQ(detail::isValidUtf8Constexpr(str), isValidUtf8(str))
+            << folly::hexlify(str);
+      }
+    }
+  }
+}
+
 TEST(Utf8String, ensureValidUtf8) {
   for (auto str : kValidStrings) {
     EXPECT_EQ(str, ensureValidUtf8(str));